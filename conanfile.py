@@ -37,6 +37,7 @@ class Flow(ConanFile):
 			self.copy("components.cpp", "source/flow/", "source/flow/")
 			self.copy("flow.cpp", "source/flow/", "source/flow/")
 			self.copy("reactor.cpp", "source/flow/", "source/flow/")
+			self.copy("record.cpp", "source/flow/", "source/flow/")
 
 		if self.settings.arch == "x86" or self.info.settings.arch == "x86_64":
 			self.copy("platform_cpputest.cpp", "source/flow/", "source/flow/")
@@ -50,3 +51,5 @@ class Flow(ConanFile):
 		self.cpp_info.libdirs = ["library/"]
 		self.cpp_info.srcdirs = ["source/"]
 		self.cpp_info.libs = ["Flow"]
+		# Connections are aligned to cache lines, allocating them needs an over-aligned new.
+		self.cpp_info.cxxflags = ["-faligned-new"]
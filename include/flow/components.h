@@ -176,6 +176,10 @@ private:
 
 /**
  * Provides one-to-many semantic.
+ *
+ * \note Every output has its own connection, so each element is copied once per output.
+ * ConnectionMulticast shares one buffer between all receivers instead.
+ * For big elements split a PoolPtr: only the handle is copied, not the element.
  */
 template<typename Type, uint8_t outputs>
 class Split: public Flow::Component
@@ -203,6 +207,9 @@ public:
  * The input port with lower index is given priority.
  * All input ports are handled in depth-first semantic:
  * all values of a input port will be processed before going to the next input port.
+ *
+ * \note When the order of the inputs does not matter, connecting the output ports
+ * directly to one input port (see ConnectionManyToOne) saves a component and a queue.
  */
 template<typename Type, uint_fast8_t inputs>
 class Combine: public Flow::Component
@@ -234,7 +241,7 @@ public:
 			Type b;
 			while (in[i]->receive(b))
 			{
-				out.send(b);
+				out.send(std::move(b));
 			}
 		}
 	}
@@ -26,6 +26,13 @@
 
 #include <assert.h>
 #include <signal.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <type_traits>
+#include <utility>
 
 #include "queue.h"
 
@@ -76,6 +83,21 @@ public:
 	 */
 	virtual bool send(const Type& element) = 0;
 
+	/**
+	 * \brief Send an element over the connection by moving it.
+	 *
+	 * If the buffering capacity of the connection is full the given element is not added.
+	 * The default implementation sends a copy,
+	 * a connection can move the element instead.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	virtual bool send(Type&& element)
+	{
+		return send(static_cast<const Type&>(element));
+	}
+
 	/**
 	 * \brief Receive an element from the connection.
 	 *
@@ -86,6 +108,198 @@ public:
 	 */
 	virtual bool receive(Type& element) = 0;
 
+	/**
+	 * \brief Send a number of consecutive elements over the connection.
+	 *
+	 * As many elements as the buffering capacity of the connection allows are sent.
+	 * The default implementation sends the elements one by one,
+	 * a connection can provide a more efficient implementation.
+	 *
+	 * \param elements The elements to be sent.
+	 * \param count The number of elements to be sent.
+	 * \return The number of elements that was sent.
+	 */
+	virtual size_t send(const Type* elements, size_t count)
+	{
+		size_t sent = 0;
+
+		while (sent < count && send(elements[sent]))
+		{
+			sent++;
+		}
+
+		return sent;
+	}
+
+	/**
+	 * \brief Receive a number of elements from the connection.
+	 *
+	 * The default implementation receives the elements one by one,
+	 * a connection can provide a more efficient implementation.
+	 *
+	 * \param elements [output] The received elements.
+	 * \param count The maximum number of elements to be received.
+	 * \return The number of elements that was received.
+	 */
+	virtual size_t receive(Type* elements, size_t count)
+	{
+		size_t received = 0;
+
+		while (received < count && receive(elements[received]))
+		{
+			received++;
+		}
+
+		return received;
+	}
+
+	/**
+	 * \brief Reserve the next element of the connection, to be filled in place.
+	 *
+	 * The element is only sent by commit().
+	 * Connections that cannot hand out their buffer return nullptr,
+	 * use send() for those.
+	 *
+	 * \return The element to be filled in.
+	 * 		nullptr if the connection is full or does not support this.
+	 */
+	virtual Type* reserve()
+	{
+		return nullptr;
+	}
+
+	/**
+	 * \brief Send the element obtained by reserve().
+	 *
+	 * \remark Only call this after reserve() returned an element.
+	 */
+	virtual void commit()
+	{
+	}
+
+	/**
+	 * \brief Access the next element to be received, in place.
+	 *
+	 * The element remains in the connection until pop() is called.
+	 * Connections that cannot hand out their buffer return nullptr,
+	 * use receive() for those.
+	 *
+	 * \return The next element to be received.
+	 * 		nullptr if the connection is empty or does not support this.
+	 */
+	virtual const Type* front()
+	{
+		return nullptr;
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the connection.
+	 *
+	 * \remark Only call this after front() returned an element.
+	 */
+	virtual void pop()
+	{
+	}
+
+	/**
+	 * \brief Access all elements that can be received, in place.
+	 *
+	 * The elements remain in the connection until consume() is called.
+	 * Connections that cannot hand out their buffer return empty spans,
+	 * use receive() for those.
+	 *
+	 * \return The elements to be received, in (at most) two contiguous regions.
+	 */
+	virtual Spans<const Type> readableSpans()
+	{
+		return Spans<const Type>();
+	}
+
+	/**
+	 * \brief Remove a number of elements obtained by readableSpans() from the connection.
+	 *
+	 * \param count The number of elements to be removed, at most the size of the spans.
+	 */
+	virtual void consume(size_t /* count */)
+	{
+	}
+
+	/**
+	 * \brief Access all free slots of the connection, to be filled in place.
+	 *
+	 * The elements are only sent by produce().
+	 * Connections that cannot hand out their buffer return empty spans,
+	 * use send() for those.
+	 *
+	 * \return The free slots, in (at most) two contiguous regions.
+	 */
+	virtual Spans<Type> writableSpans()
+	{
+		return Spans<Type>();
+	}
+
+	/**
+	 * \brief Send a number of elements written in the spans obtained by writableSpans().
+	 *
+	 * \param count The number of elements to be sent, at most the size of the spans.
+	 */
+	virtual void produce(size_t /* count */)
+	{
+	}
+
+	/**
+	 * \brief The number of elements lost just before the element last received.
+	 *
+	 * Only a lossy connection (see ConnectionOverwrite) drops elements,
+	 * the default implementation returns 0.
+	 */
+	virtual size_t overwritten() const
+	{
+		return 0;
+	}
+
+	/**
+	 * \brief Send an element, waiting while the connection is full.
+	 *
+	 * Only a waitable connection (see ConnectionWaitable) can block the sender,
+	 * the default implementation sends once, as send().
+	 *
+	 * \param element The element to be sent.
+	 * \param timeout The longest time to wait.
+	 * \return The element was successfully sent.
+	 */
+	virtual bool sendWait(const Type& element, std::chrono::nanoseconds /* timeout */)
+	{
+		return send(element);
+	}
+
+	/**
+	 * \brief Send an element by moving it, waiting while the connection is full.
+	 *
+	 * \param element The element to be sent.
+	 * \param timeout The longest time to wait.
+	 * \return The element was successfully sent.
+	 */
+	virtual bool sendWait(Type&& element, std::chrono::nanoseconds /* timeout */)
+	{
+		return send(std::move(element));
+	}
+
+	/**
+	 * \brief Receive an element, waiting while the connection is empty.
+	 *
+	 * Only a waitable connection (see ConnectionWaitable) can block the receiver,
+	 * the default implementation receives once, as receive().
+	 *
+	 * \param element [output] The received element.
+	 * \param timeout The longest time to wait.
+	 * \return An element was successfully received.
+	 */
+	virtual bool receiveWait(Type& element, std::chrono::nanoseconds /* timeout */)
+	{
+		return receive(element);
+	}
+
 	/**
 	 * \brief Is an element available for receiving?
 	 */
@@ -154,15 +368,60 @@ private:
 	friend class Reactor;
 };
 
+/**
+ * \brief Copy elements into a connection, when Type can be copied at all.
+ *
+ * A connection implements send(const Type&) by CopyIn<Type>::send(*this, element),
+ * which calls its private copyIn(const Type&) (or copyIn(const Type*, size_t) for a batch).
+ * Only rvalues of a move-only Type can be sent, OutPort rejects the rest at compile time.
+ * For a move-only Type copyIn() is not instantiated, so it only has to compile for copyable types.
+ *
+ * \tparam Type The type of the elements.
+ */
+template<typename Type, bool copyable = std::is_copy_constructible<Type>::value>
+struct CopyIn
+{
+	template<typename ConnectionType>
+	static bool send(ConnectionType& connection, const Type& element)
+	{
+		return connection.copyIn(element);
+	}
+
+	template<typename ConnectionType>
+	static size_t send(ConnectionType& connection, const Type* elements, size_t count)
+	{
+		return connection.copyIn(elements, count);
+	}
+};
+
+template<typename Type>
+struct CopyIn<Type, false>
+{
+	template<typename ConnectionType>
+	static bool send(ConnectionType&, const Type&)
+	{
+		return false;
+	}
+
+	template<typename ConnectionType>
+	static size_t send(ConnectionType&, const Type*, size_t)
+	{
+		return 0;
+	}
+};
+
 /**
  * \brief A connection of some type between component ports.
  *
  * \note Recommendation: use Flow::connect() instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * \tparam QueueType The queue buffering the elements, Queue or StaticQueue.
  */
-template<typename Type>
+template<typename Type, typename QueueType = Queue<Type>>
 class ConnectionFIFO :
 		public ConnectionOfType<Type>,
-		protected Queue<Type>
+		protected QueueType
 {
 public:
 	/**
@@ -173,8 +432,24 @@ public:
 	 * \param size The amount of elements the connection can buffer.
 	 */
 	ConnectionFIFO(OutPort<Type>& sender, InPort<Type>& receiver,
-			uint16_t size) :
-			Queue<Type>(size), sender(sender), receiver(receiver)
+			typename QueueType::Index size) :
+			QueueType(size), sender(sender), receiver(receiver)
+	{
+		sender.connect(this);
+		receiver.connect(this);
+	}
+
+	/**
+	 * \brief Create a connection between an output and input port.
+	 *
+	 * The amount of elements the connection can buffer is defined by the QueueType,
+	 * typically a StaticQueue.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param receiver The input port to be connected.
+	 */
+	ConnectionFIFO(OutPort<Type>& sender, InPort<Type>& receiver) :
+			QueueType(), sender(sender), receiver(receiver)
 	{
 		sender.connect(this);
 		receiver.connect(this);
@@ -200,13 +475,28 @@ public:
 	 */
 	bool send(const Type& element) final override
 	{
-		return this->enqueue(element);
+		return CopyIn<Type>::send(*this, element);
+	}
+
+	/**
+	 * \brief Send an element over the connection by moving it.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 * If the buffering capacity of the connection is full the given element is not added.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(Type&& element) final override
+	{
+		return this->enqueue(std::move(element));
 	}
 
 	/**
 	 * \brief Receive an element from the connection.
 	 *
 	 * Can be called concurrently with respect to send().
+	 * The element is moved out of the connection.
 	 *
 	 * \param element [output] The received element.
 	 * 		The return value indicates whether the element is valid.
@@ -218,6 +508,115 @@ public:
 		return this->dequeue(element);
 	}
 
+	/**
+	 * \brief Send a number of consecutive elements over the connection.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 * The elements are enqueued in one go, see Queue::enqueue().
+	 *
+	 * \param elements The elements to be sent.
+	 * \param count The number of elements to be sent.
+	 * \return The number of elements that was sent.
+	 */
+	size_t send(const Type* elements, size_t count) final override
+	{
+		return CopyIn<Type>::send(*this, elements, count);
+	}
+
+	/**
+	 * \brief Receive a number of elements from the connection.
+	 *
+	 * Can be called concurrently with respect to send().
+	 * The elements are dequeued in one go, see Queue::dequeue().
+	 *
+	 * \param elements [output] The received elements.
+	 * \param count The maximum number of elements to be received.
+	 * \return The number of elements that was received.
+	 */
+	size_t receive(Type* elements, size_t count) final override
+	{
+		return this->dequeue(elements, clamp(count));
+	}
+
+	/**
+	 * \brief Reserve the next element of the connection, to be filled in place.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 *
+	 * \return The element to be filled in.
+	 * 		nullptr if the connection is full.
+	 */
+	Type* reserve() final override
+	{
+		return QueueType::reserve();
+	}
+
+	/**
+	 * \brief Send the element obtained by reserve().
+	 */
+	void commit() final override
+	{
+		QueueType::commit();
+	}
+
+	/**
+	 * \brief Access the next element to be received, in place.
+	 *
+	 * Can be called concurrently with respect to send().
+	 *
+	 * \return The next element to be received.
+	 * 		nullptr if the connection is empty.
+	 */
+	const Type* front() final override
+	{
+		return QueueType::front();
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the connection.
+	 */
+	void pop() final override
+	{
+		QueueType::pop();
+	}
+
+	/**
+	 * \brief Access all elements that can be received, in place.
+	 *
+	 * Can be called concurrently with respect to send().
+	 */
+	Spans<const Type> readableSpans() final override
+	{
+		return QueueType::readableSpans();
+	}
+
+	/**
+	 * \brief Remove a number of elements obtained by readableSpans() from the connection.
+	 */
+	void consume(size_t count) final override
+	{
+		QueueType::consume(static_cast<typename QueueType::Index>(count));
+	}
+
+	/**
+	 * \brief Access all free slots of the connection, to be filled in place.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 * Only trivial types can be written in place, for others the spans are empty.
+	 */
+	Spans<Type> writableSpans() final override
+	{
+		return writable(std::is_trivial<Type>());
+	}
+
+	/**
+	 * \brief Send a number of elements written in the spans obtained by writableSpans().
+	 */
+	void produce(size_t count) final override
+	{
+		QueueType::produce(static_cast<typename QueueType::Index>(count));
+	}
+
 	/**
 	 * \brief Is an element available for receiving?
 	 */
@@ -234,71 +633,228 @@ public:
 		return this->isFull();
 	}
 
+	/**
+	 * \brief The instrumentation of the queue buffering the elements.
+	 *
+	 * Records the occupancy of the connection when the QueueType
+	 * has OccupancyStatistics as instrumentation policy.
+	 */
+	const typename QueueType::Instrumentation& instrumentation() const
+	{
+		return *this;
+	}
+
 private:
 	OutPort<Type>& sender;
 	InPort<Type>& receiver;
+
+	static typename QueueType::Index clamp(size_t count)
+	{
+		return static_cast<typename QueueType::Index>(std::min<size_t>(count,
+				std::numeric_limits<typename QueueType::Index>::max()));
+	}
+
+	friend struct CopyIn<Type>;
+
+	bool copyIn(const Type& element)
+	{
+		return this->enqueue(element);
+	}
+
+	size_t copyIn(const Type* elements, size_t count)
+	{
+		return this->enqueue(elements, clamp(count));
+	}
+
+	Spans<Type> writable(std::true_type /* trivial */)
+	{
+		return QueueType::writableSpans();
+	}
+
+	Spans<Type> writable(std::false_type /* trivial */)
+	{
+		return Spans<Type>();
+	}
 };
 
+/**
+ * \brief A connection of some type between component ports,
+ * buffering a number of elements known at compile time.
+ *
+ * The buffer is part of the connection itself. A connection defined with static storage duration
+ * involves no heap at all, all of its memory ends up in .bss.
+ * Flow::connect<size>() allocates the connection (buffer included) on the heap in one go.
+ *
+ * \note Recommendation: define the connection statically to keep it off the heap,
+ * 		otherwise use Flow::connect<size>().
+ */
+template<typename Type, size_t size, typename IndexType = typename SmallestIndex<size>::type>
+using StaticConnectionFIFO = ConnectionFIFO<Type, StaticQueue<Type, size, IndexType>>;
+
 /**
  * \brief A bidirectional connection of some type between bidirectional component ports.
  *
  * \note Recommendation: use Flow::connect() instead.
  */
-template<typename Type>
+template<typename Type, typename QueueType = Queue<Type>>
 class BiDirectionalConnectionFIFO :
 		public Connection
 {
 public:
 	BiDirectionalConnectionFIFO(InOutPort<Type>& portA, InOutPort<Type>& portB,
-			uint16_t size) :
-			connectionA(ConnectionFIFO<Type>(portA, portB, size)),
-			connectionB(ConnectionFIFO<Type>(portB, portA, size))
+			typename QueueType::Index size) :
+			connectionA(portA, portB, size),
+			connectionB(portB, portA, size)
+	{}
+
+	BiDirectionalConnectionFIFO(InOutPort<Type>& portA, InOutPort<Type>& portB) :
+			connectionA(portA, portB),
+			connectionB(portB, portA)
 	{}
 
-private:
-	ConnectionFIFO<Type> connectionA, connectionB;
-};
+private:
+	ConnectionFIFO<Type, QueueType> connectionA, connectionB;
+};
+
+class Peek
+{
+public:
+	Peek(Component* owner);
+	virtual ~Peek() = default;
+	virtual bool peek() const = 0;
+
+	Peek* next = nullptr;
+};
+
+/**
+ * \brief An input port of a component.
+ */
+template<typename Type>
+class InPort :
+		protected Peek
+{
+public:
+	/**
+	 * \brief Create an input port.
+	 */
+	explicit InPort<Type>(Component* owner) :
+			Peek(owner),
+			connection(nullptr)
+	{
+	}
+
+	/**
+	 * \brief Receive an element from the input port.
+	 *
+	 * Can be called concurrently with respect to send() of the connected output port.
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool receive(Type& element)
+	{
+		return this->isConnected() ? this->connection->receive(element) : false;
+	}
+
+	/**
+	 * \brief Receive a number of elements from the input port.
+	 *
+	 * Can be called concurrently with respect to send() of the connected output port.
+	 *
+	 * \param elements [output] The received elements.
+	 * \param count The maximum number of elements to be received.
+	 * \return The number of elements that was received.
+	 */
+	size_t receive(Type* elements, size_t count)
+	{
+		return this->isConnected() ? this->connection->receive(elements, count) : 0;
+	}
+
+	/**
+	 * \brief Access the next element to be received, in place.
+	 *
+	 * Can be called concurrently with respect to send() of the connected output port.
+	 * The element remains in the connection until pop() is called.
+	 *
+	 * \return The next element to be received.
+	 * 		nullptr if the connection is empty, does not support this or the port is not connected.
+	 */
+	const Type* front()
+	{
+		return this->isConnected() ? this->connection->front() : nullptr;
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the connection.
+	 *
+	 * \remark Only call this after front() returned an element.
+	 */
+	void pop()
+	{
+		if(this->isConnected())
+		{
+			this->connection->pop();
+		}
+	}
 
-class Peek
-{
-public:
-	Peek(Component* owner);
-	virtual ~Peek() = default;
-	virtual bool peek() const = 0;
+	/**
+	 * \brief Access all elements that can be received, in place.
+	 *
+	 * Can be called concurrently with respect to send() of the connected output port.
+	 * The elements remain in the connection until consume() is called,
+	 * so they can be processed without copying them out first.
+	 *
+	 * \return The elements to be received, in (at most) two contiguous regions.
+	 * 		Empty if the connection is empty, does not support this or the port is not connected.
+	 */
+	Spans<const Type> readableSpans()
+	{
+		return this->isConnected() ? this->connection->readableSpans() : Spans<const Type>();
+	}
 
-	Peek* next = nullptr;
-};
+	/**
+	 * \brief Remove a number of elements obtained by readableSpans() from the connection.
+	 *
+	 * \remark The count must not exceed the size of the spans.
+	 *
+	 * \param count The number of elements to be removed.
+	 */
+	void consume(size_t count)
+	{
+		if(this->isConnected())
+		{
+			this->connection->consume(count);
+		}
+	}
 
-/**
- * \brief An input port of a component.
- */
-template<typename Type>
-class InPort :
-		protected Peek
-{
-public:
 	/**
-	 * \brief Create an input port.
+	 * \brief The number of elements the connection dropped just before the element last received.
+	 *
+	 * \return The number of overwritten elements.
+	 * 		0 if the connection is not lossy or the port is not connected.
 	 */
-	explicit InPort<Type>(Component* owner) :
-			Peek(owner),
-			connection(nullptr)
+	size_t overwritten() const
 	{
+		return this->isConnected() ? this->connection->overwritten() : 0;
 	}
 
 	/**
-	 * \brief Receive an element from the input port.
+	 * \brief Receive an element from the input port, waiting while none is available.
 	 *
-	 * Can be called concurrently with respect to send() of the connected output port.
+	 * Blocks the calling thread only when the connection supports waiting
+	 * (see ConnectionWaitable), otherwise it behaves as receive().
 	 *
 	 * \param element [output] The received element.
-	 * 		The return value indicates whether the element is valid.
+	 * \param timeout The longest time to wait, by default there is no limit.
 	 * \return An element was successfully received.
-	 * 		Thus the element output parameter has a valid value.
+	 * 		False on timeout or if the port is not connected.
 	 */
-	bool receive(Type& element)
+	bool receiveWait(Type& element,
+			std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
 	{
-		return this->isConnected() ? this->connection->receive(element) : false;
+		return this->isConnected() ? this->connection->receiveWait(element, timeout) : false;
 	}
 
 	/**
@@ -389,9 +945,152 @@ public:
 	 */
 	bool send(const Type& element)
 	{
+		static_assert(std::is_copy_constructible<Type>::value,
+				"A move-only type can only be sent as rvalue.");
+
 		return this->isConnected() ? this->connection->send(element) : false;
 	}
 
+	/**
+	 * \brief Send an element from the output port by moving it.
+	 *
+	 * Can be called concurrently with respect to receive() of the connected input port.
+	 * If the buffering capacity of the connection is full or the port is not connected
+	 * the given element is not added.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(Type&& element)
+	{
+		return this->isConnected() ? this->connection->send(std::move(element)) : false;
+	}
+
+	/**
+	 * \brief Send an element from the output port, waiting while the connection is full.
+	 *
+	 * Blocks the calling thread only when the connection supports waiting
+	 * (see ConnectionWaitable), otherwise it behaves as send().
+	 *
+	 * \param element The element to be sent.
+	 * \param timeout The longest time to wait, by default there is no limit.
+	 * \return The element was successfully sent.
+	 * 		False on timeout or if the port is not connected.
+	 */
+	bool sendWait(const Type& element,
+			std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
+	{
+		static_assert(std::is_copy_constructible<Type>::value,
+				"A move-only type can only be sent as rvalue.");
+
+		return this->isConnected() ? this->connection->sendWait(element, timeout) : false;
+	}
+
+	/**
+	 * \brief Send an element from the output port by moving it,
+	 * waiting while the connection is full.
+	 *
+	 * \param element The element to be sent.
+	 * \param timeout The longest time to wait, by default there is no limit.
+	 * \return The element was successfully sent.
+	 * 		False on timeout or if the port is not connected.
+	 */
+	bool sendWait(Type&& element,
+			std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
+	{
+		return this->isConnected() ? this->connection->sendWait(std::move(element), timeout) : false;
+	}
+
+	/**
+	 * \brief Send an element constructed from the given arguments.
+	 *
+	 * Can be called concurrently with respect to receive() of the connected input port.
+	 * The element is constructed once and moved into the connection.
+	 *
+	 * \param arguments The arguments for the constructor of Type.
+	 * \return The element was successfully sent.
+	 */
+	template<typename... Arguments>
+	bool emplace(Arguments&&... arguments)
+	{
+		return this->isConnected() ?
+				this->connection->send(Type(std::forward<Arguments>(arguments)...)) : false;
+	}
+
+	/**
+	 * \brief Send a number of consecutive elements from the output port.
+	 *
+	 * Can be called concurrently with respect to receive() of the connected input port.
+	 * As many elements as the buffering capacity of the connection allows are sent.
+	 *
+	 * \param elements The elements to be sent.
+	 * \param count The number of elements to be sent.
+	 * \return The number of elements that was sent.
+	 */
+	size_t send(const Type* elements, size_t count)
+	{
+		static_assert(std::is_copy_constructible<Type>::value,
+				"A move-only type can only be sent as rvalue.");
+
+		return this->isConnected() ? this->connection->send(elements, count) : 0;
+	}
+
+	/**
+	 * \brief Reserve the next element of the connection, to be filled in place.
+	 *
+	 * Can be called concurrently with respect to receive() of the connected input port.
+	 * The element is only sent by commit().
+	 *
+	 * \return The element to be filled in.
+	 * 		nullptr if the connection is full, does not support this or the port is not connected.
+	 */
+	Type* reserve()
+	{
+		return this->isConnected() ? this->connection->reserve() : nullptr;
+	}
+
+	/**
+	 * \brief Send the element obtained by reserve().
+	 *
+	 * \remark Only call this after reserve() returned an element.
+	 */
+	void commit()
+	{
+		if(this->isConnected())
+		{
+			this->connection->commit();
+		}
+	}
+
+	/**
+	 * \brief Access all free slots of the connection, to be filled in place.
+	 *
+	 * Can be called concurrently with respect to receive() of the connected input port.
+	 * The elements are only sent by produce().
+	 *
+	 * \return The free slots, in (at most) two contiguous regions.
+	 * 		Empty if the connection is full, does not support this or the port is not connected.
+	 */
+	Spans<Type> writableSpans()
+	{
+		return this->isConnected() ? this->connection->writableSpans() : Spans<Type>();
+	}
+
+	/**
+	 * \brief Send a number of elements written in the spans obtained by writableSpans().
+	 *
+	 * \remark The count must not exceed the size of the spans.
+	 *
+	 * \param count The number of elements to be sent.
+	 */
+	void produce(size_t count)
+	{
+		if(this->isConnected())
+		{
+			this->connection->produce(count);
+		}
+	}
+
 	/**
 	 * \brief Is the connection associated with this output port full?
 	 */
@@ -460,127 +1159,361 @@ void disconnect(Connection* connection);
 /**
  * \brief Connect an output port to an input port.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(sender, receiver, 1000000).
  * \param sender The output port to be connected.
  * \param receiver The input port to be connected.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(OutPort<Type>& sender, InPort<Type>& receiver,
-		uint16_t size = 1)
+		size_t size = 1)
 {
-	return new ConnectionFIFO<Type>(sender, receiver, size);
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new ConnectionFIFO<Type, Queue<Type, IndexType>>(sender, receiver,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
 }
 
 /**
  * \brief Connect an output port to an input port.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(sender, receiver, 1000000).
  * \param sender The output port to be connected.
  * \param receiver The input port to be connected.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(OutPort<Type>* sender, InPort<Type>& receiver,
-		uint16_t size = 1)
+		size_t size = 1)
 {
 	assert(sender != nullptr);
 
-	return new ConnectionFIFO<Type>(*sender, receiver, size);
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new ConnectionFIFO<Type, Queue<Type, IndexType>>(*sender, receiver,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
 }
 
 /**
  * \brief Connect an output port to an input port.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(sender, receiver, 1000000).
  * \param sender The output port to be connected.
  * \param receiver The input port to be connected.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(OutPort<Type>& sender, InPort<Type>* receiver,
-		uint16_t size = 1)
+		size_t size = 1)
 {
 	assert(receiver != nullptr);
 
-	return new ConnectionFIFO<Type>(sender, *receiver, size);
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new ConnectionFIFO<Type, Queue<Type, IndexType>>(sender, *receiver,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
 }
 
 /**
  * \brief Connect an output port to an input port.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(sender, receiver, 1000000).
  * \param sender The output port to be connected.
  * \param receiver The input port to be connected.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(OutPort<Type>* sender, InPort<Type>* receiver,
-		uint16_t size = 1)
+		size_t size = 1)
 {
 	assert(sender != nullptr);
 	assert(receiver != nullptr);
 
-	return new ConnectionFIFO<Type>(*sender, *receiver, size);
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new ConnectionFIFO<Type, Queue<Type, IndexType>>(*sender, *receiver,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
 }
 
 /**
  * \brief Connect two bidirectional ports.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(portA, portB, 1000000).
  * \param portA One of the bidirectional ports.
  * \param portB The other of the bidirectional ports.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(InOutPort<Type>& portA, InOutPort<Type>& portB,
-		uint16_t size = 1)
+		size_t size = 1)
 {
-	return new BiDirectionalConnectionFIFO<Type>(portA, portB, size);
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new BiDirectionalConnectionFIFO<Type, Queue<Type, IndexType>>(portA, portB,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
 }
 
 /**
  * \brief Connect two bidirectional ports.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(portA, portB, 1000000).
  * \param portA One of the bidirectional ports.
  * \param portB The other of the bidirectional ports.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(InOutPort<Type>* portA, InOutPort<Type>& portB,
-		uint16_t size = 1)
+		size_t size = 1)
 {
 	assert(portA != nullptr);
 
-	return new BiDirectionalConnectionFIFO<Type>(*portA, portB, size);
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new BiDirectionalConnectionFIFO<Type, Queue<Type, IndexType>>(*portA, portB,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
 }
 
 /**
  * \brief Connect two bidirectional ports.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(portA, portB, 1000000).
  * \param portA One of the bidirectional ports.
  * \param portB The other of the bidirectional ports.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(InOutPort<Type>& portA, InOutPort<Type>* portB,
-		uint16_t size = 1)
+		size_t size = 1)
 {
 	assert(portB != nullptr);
 
-	return new BiDirectionalConnectionFIFO<Type>(portA, *portB, size);
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new BiDirectionalConnectionFIFO<Type, Queue<Type, IndexType>>(portA, *portB,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
 }
 
 /**
  * \brief Connect two bidirectional ports.
  *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue,
+ * 		it limits the size. For example connect<Data, uint32_t>(portA, portB, 1000000).
  * \param portA One of the bidirectional ports.
  * \param portB The other of the bidirectional ports.
  * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
  */
-template<typename Type>
+template<typename Type, typename IndexType = uint16_t>
 Connection* connect(InOutPort<Type>* portA, InOutPort<Type>* portB,
-		uint16_t size = 1)
+		size_t size = 1)
+{
+	assert(portA != nullptr);
+	assert(portB != nullptr);
+
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new BiDirectionalConnectionFIFO<Type, Queue<Type, IndexType>>(*portA, *portB,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
+}
+
+/**
+ * \brief Connect an output port to an input port,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * The connection is allocated on the heap, with its buffer inside it: one allocation.
+ * To avoid the heap altogether define a StaticConnectionFIFO statically instead.
+ *
+ * \tparam size The amount of elements the connection can buffer.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ */
+template<size_t size, typename Type>
+Connection* connect(OutPort<Type>& sender, InPort<Type>& receiver)
+{
+	return new StaticConnectionFIFO<Type, size>(sender, receiver);
+}
+
+/**
+ * \brief Connect an output port to an input port,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * The connection is allocated on the heap, with its buffer inside it: one allocation.
+ * To avoid the heap altogether define a StaticConnectionFIFO statically instead.
+ *
+ * \tparam size The amount of elements the connection can buffer.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ */
+template<size_t size, typename Type>
+Connection* connect(OutPort<Type>* sender, InPort<Type>& receiver)
+{
+	assert(sender != nullptr);
+
+	return new StaticConnectionFIFO<Type, size>(*sender, receiver);
+}
+
+/**
+ * \brief Connect an output port to an input port,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * The connection is allocated on the heap, with its buffer inside it: one allocation.
+ * To avoid the heap altogether define a StaticConnectionFIFO statically instead.
+ *
+ * \tparam size The amount of elements the connection can buffer.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ */
+template<size_t size, typename Type>
+Connection* connect(OutPort<Type>& sender, InPort<Type>* receiver)
+{
+	assert(receiver != nullptr);
+
+	return new StaticConnectionFIFO<Type, size>(sender, *receiver);
+}
+
+/**
+ * \brief Connect an output port to an input port,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * The connection is allocated on the heap, with its buffer inside it: one allocation.
+ * To avoid the heap altogether define a StaticConnectionFIFO statically instead.
+ *
+ * \tparam size The amount of elements the connection can buffer.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ */
+template<size_t size, typename Type>
+Connection* connect(OutPort<Type>* sender, InPort<Type>* receiver)
+{
+	assert(sender != nullptr);
+	assert(receiver != nullptr);
+
+	return new StaticConnectionFIFO<Type, size>(*sender, *receiver);
+}
+
+/**
+ * \brief Connect two bidirectional ports,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * \tparam size The amount of elements the connection can buffer (in each direction).
+ * \param portA One of the bidirectional ports.
+ * \param portB The other of the bidirectional ports.
+ */
+template<size_t size, typename Type>
+Connection* connect(InOutPort<Type>& portA, InOutPort<Type>& portB)
+{
+	return new BiDirectionalConnectionFIFO<Type, StaticQueue<Type, size>>(portA, portB);
+}
+
+/**
+ * \brief Connect two bidirectional ports,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * \tparam size The amount of elements the connection can buffer (in each direction).
+ * \param portA One of the bidirectional ports.
+ * \param portB The other of the bidirectional ports.
+ */
+template<size_t size, typename Type>
+Connection* connect(InOutPort<Type>* portA, InOutPort<Type>& portB)
+{
+	assert(portA != nullptr);
+
+	return new BiDirectionalConnectionFIFO<Type, StaticQueue<Type, size>>(*portA, portB);
+}
+
+/**
+ * \brief Connect two bidirectional ports,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * \tparam size The amount of elements the connection can buffer (in each direction).
+ * \param portA One of the bidirectional ports.
+ * \param portB The other of the bidirectional ports.
+ */
+template<size_t size, typename Type>
+Connection* connect(InOutPort<Type>& portA, InOutPort<Type>* portB)
+{
+	assert(portB != nullptr);
+
+	return new BiDirectionalConnectionFIFO<Type, StaticQueue<Type, size>>(portA, *portB);
+}
+
+/**
+ * \brief Connect two bidirectional ports,
+ * the buffering capacity of the connection is known at compile time.
+ *
+ * \tparam size The amount of elements the connection can buffer (in each direction).
+ * \param portA One of the bidirectional ports.
+ * \param portB The other of the bidirectional ports.
+ */
+template<size_t size, typename Type>
+Connection* connect(InOutPort<Type>* portA, InOutPort<Type>* portB)
 {
 	assert(portA != nullptr);
 	assert(portB != nullptr);
 
-	return new BiDirectionalConnectionFIFO<Type>(*portA, *portB, size);
+	return new BiDirectionalConnectionFIFO<Type, StaticQueue<Type, size>>(*portA, *portB);
 }
 
 class InTrigger;
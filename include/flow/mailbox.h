@@ -0,0 +1,223 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef FLOW_MAILBOX_H_
+#define FLOW_MAILBOX_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <utility>
+
+#include "flow.h"
+
+namespace Flow
+{
+
+/**
+ * \brief A connection of some type that only holds the latest value, a mailbox.
+ *
+ * Sending always succeeds and replaces the value, the receiver gets the newest value
+ * and whether it was updated since it last received. Useful for setpoints,
+ * configuration and state, where a stale value is worse than a missed one.
+ *
+ * The mailbox is a triple buffer: the sender writes into its own back buffer
+ * and swaps it with the middle buffer, the receiver swaps the middle buffer with its own
+ * front buffer when it holds a fresh value. Both swaps are a single atomic exchange,
+ * neither side ever waits for the other (nor copies a torn value), so the sender can be an interrupt
+ * (on cores with an atomic exchange of a byte, e.g. not on a Cortex-M0).
+ *
+ * \note Recommendation: use Flow::connectMailbox() instead.
+ *
+ * \tparam Type The type of the value, it has to be default constructible and assignable.
+ */
+template<typename Type>
+class ConnectionMailbox :
+		public ConnectionOfType<Type>
+{
+public:
+	/**
+	 * \brief Create a mailbox between an output and input port.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param receiver The input port to be connected.
+	 */
+	ConnectionMailbox(OutPort<Type>& sender, InPort<Type>& receiver) :
+			_back(0),
+			_middle(1),
+			_front(2),
+			_valid(false),
+			sender(sender),
+			receiver(receiver)
+	{
+		sender.connect(this);
+		receiver.connect(this);
+	}
+
+	ConnectionMailbox(const ConnectionMailbox&) = delete;
+	ConnectionMailbox& operator=(const ConnectionMailbox&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 */
+	virtual ~ConnectionMailbox()
+	{
+		sender.disconnect();
+		receiver.disconnect();
+	}
+
+	/**
+	 * \brief Replace the value in the mailbox.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 *
+	 * \param element The new value.
+	 * \return Always true.
+	 */
+	bool send(const Type& element) final override
+	{
+		_buffers[_back] = element;
+		publish();
+
+		return true;
+	}
+
+	/**
+	 * \brief Replace the value in the mailbox, by moving the new value.
+	 *
+	 * \param element The new value.
+	 * \return Always true.
+	 */
+	bool send(Type&& element) final override
+	{
+		_buffers[_back] = std::move(element);
+		publish();
+
+		return true;
+	}
+
+	/**
+	 * \brief Receive the latest value.
+	 *
+	 * Can be called concurrently with respect to send().
+	 *
+	 * \param element [output] The latest value, as soon as a value was sent
+	 * 		(the element is left untouched before).
+	 * \return The value was updated since the last receive.
+	 */
+	bool receive(Type& element) final override
+	{
+		const bool updated = update();
+
+		if (_valid)
+		{
+			element = _buffers[_front];
+		}
+
+		return updated;
+	}
+
+	/**
+	 * \brief Access the latest value in place.
+	 *
+	 * \return The latest value.
+	 * 		nullptr if no value was sent yet.
+	 */
+	const Type* front() final override
+	{
+		update();
+
+		return _valid ? &_buffers[_front] : nullptr;
+	}
+
+	/**
+	 * \brief Is a value available that was not received yet?
+	 */
+	bool peek() const final override
+	{
+		return (_middle.load(std::memory_order_relaxed) & FRESH) != 0;
+	}
+
+	/**
+	 * \brief A mailbox is never full.
+	 */
+	bool full() const final override
+	{
+		return false;
+	}
+
+private:
+	// The middle buffer holds a value the receiver did not take yet.
+	static const uint8_t FRESH = 0x4;
+	static const uint8_t INDEX = 0x3;
+
+	Type _buffers[3];
+
+	// Owned by the sender.
+	uint8_t _back;
+
+	// Index of the middle buffer and FRESH, exchanged by both.
+	std::atomic<uint8_t> _middle;
+
+	// Owned by the receiver.
+	uint8_t _front;
+	bool _valid;
+
+	OutPort<Type>& sender;
+	InPort<Type>& receiver;
+
+	void publish()
+	{
+		_back = _middle.exchange(static_cast<uint8_t>(_back | FRESH), std::memory_order_acq_rel) & INDEX;
+	}
+
+	bool update()
+	{
+		bool updated = false;
+
+		if ((_middle.load(std::memory_order_relaxed) & FRESH) != 0)
+		{
+			_front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+			_valid = true;
+
+			updated = true;
+		}
+
+		return updated;
+	}
+};
+
+/**
+ * \brief Connect an output port to an input port by a mailbox, holding only the latest value.
+ *
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ */
+template<typename Type>
+Connection* connectMailbox(OutPort<Type>& sender, InPort<Type>& receiver)
+{
+	return new ConnectionMailbox<Type>(sender, receiver);
+}
+
+} // namespace Flow
+
+#endif /* FLOW_MAILBOX_H_ */
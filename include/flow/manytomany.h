@@ -0,0 +1,460 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef FLOW_MANYTOMANY_H_
+#define FLOW_MANYTOMANY_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "flow.h"
+#include "utility.h"
+
+namespace Flow
+{
+
+/**
+ * \brief Implementation of a bounded multiple producer, multiple consumer (MPMC) queue.
+ *
+ * Any number of producers and consumers can use the queue concurrently,
+ * which makes it a shared backlog for a pool of workers.
+ * Every slot carries a sequence number telling whether it is free (for round n)
+ * or holds an element (of round n). Producers claim a slot by a compare-and-swap
+ * of the tail counter, consumers by a compare-and-swap of the head counter.
+ * The element is published to the consumers (and the slot handed back to the producers)
+ * by a release store of the sequence number, see D. Vyukov's bounded MPMC queue.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and sequence numbers,
+ * 		the capacity is limited to half its range.
+ */
+template<typename DataType, typename IndexType = uint16_t>
+class ManyToManyQueue
+{
+	static_assert(std::is_unsigned<IndexType>::value, "The index type must be an unsigned integer type.");
+
+public:
+	/**
+	 * \brief The type of the indices and sequence numbers, the capacity.
+	 */
+	typedef IndexType Index;
+
+	/**
+	 * \brief Create a queue.
+	 *
+	 * The slots are allocated on the heap, their number is rounded up to a power of two
+	 * (of at least two).
+	 *
+	 * \param size The minimal size of the queue in number of DataType.
+	 */
+	explicit ManyToManyQueue(IndexType size) :
+			// A single slot can not tell a free slot from a full one in the next round.
+			_mask(roundUpToPowerOf2<IndexType>(size, 2) - 1),
+			_tail(0),
+			_head(0)
+	{
+		_slots = new Slot[capacity()];
+
+		for (IndexType i = 0; i < capacity(); i++)
+		{
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	ManyToManyQueue(const ManyToManyQueue&) = delete;
+	ManyToManyQueue& operator=(const ManyToManyQueue&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the remaining elements and
+	 * deallocates the slots from the heap.
+	 */
+	~ManyToManyQueue()
+	{
+		const IndexType tail = _tail.load(std::memory_order_relaxed);
+
+		for (IndexType index = _head.load(std::memory_order_relaxed); index != tail; index++)
+		{
+			reinterpret_cast<DataType*>(&_slots[index & _mask].element)->~DataType();
+		}
+
+		delete[] _slots;
+	}
+
+	/**
+	 * \brief The size of the queue in number of DataType.
+	 */
+	IndexType capacity() const
+	{
+		return static_cast<IndexType>(_mask + 1);
+	}
+
+	/**
+	 * \brief Is the queue empty?
+	 *
+	 * With concurrent consumers this is a snapshot, a following dequeue() can still fail.
+	 */
+	bool isEmpty() const
+	{
+		const IndexType head = _head.load(std::memory_order_relaxed);
+
+		return (distance(_slots[head & _mask].sequence.load(std::memory_order_acquire), head + 1) < 0);
+	}
+
+	/**
+	 * \brief Is the queue full?
+	 *
+	 * With concurrent producers this is a snapshot, a following enqueue() can still fail.
+	 */
+	bool isFull() const
+	{
+		const IndexType tail = _tail.load(std::memory_order_relaxed);
+
+		return (distance(_slots[tail & _mask].sequence.load(std::memory_order_acquire), tail) < 0);
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType.
+	 *
+	 * Can be called concurrently by any number of producers and consumers.
+	 * If the queue is full the given element is not added.
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(const DataType& element)
+	{
+		return emplace(element);
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType by moving it into the queue.
+	 *
+	 * If the queue is full the given element is not added (nor moved from).
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(DataType&& element)
+	{
+		return emplace(std::move(element));
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType constructed from the given arguments.
+	 *
+	 * If the queue is full no element is constructed.
+	 *
+	 * \param arguments The arguments for the constructor of DataType.
+	 * \return The element was successfully enqueued.
+	 */
+	template<typename... Arguments>
+	bool emplace(Arguments&&... arguments)
+	{
+		// A free slot of this round has the sequence number of its position.
+		Slot* slot = claim(_tail, 0);
+
+		if (slot == nullptr)
+		{
+			return false;
+		}
+
+		const IndexType position = slot->sequence.load(std::memory_order_relaxed);
+
+		new (&slot->element) DataType(std::forward<Arguments>(arguments)...);
+
+		slot->sequence.store(static_cast<IndexType>(position + 1), std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * \brief Dequeue an element of DataType.
+	 *
+	 * Can be called concurrently by any number of producers and consumers.
+	 * The element is moved out of the queue.
+	 *
+	 * \param element [output] The dequeued element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully dequeued.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool dequeue(DataType& element)
+	{
+		// A slot holding an element of this round has the sequence number of its position plus one.
+		Slot* slot = claim(_head, 1);
+
+		if (slot == nullptr)
+		{
+			return false;
+		}
+
+		const IndexType position = static_cast<IndexType>(slot->sequence.load(std::memory_order_relaxed) - 1);
+
+		DataType* first = reinterpret_cast<DataType*>(&slot->element);
+		element = std::move(*first);
+		first->~DataType();
+
+		// Hand the slot back to the producers, for the next round.
+		slot->sequence.store(static_cast<IndexType>(position + capacity()), std::memory_order_release);
+
+		return true;
+	}
+
+private:
+	typedef typename std::make_signed<IndexType>::type Difference;
+
+	struct Slot
+	{
+		std::atomic<IndexType> sequence;
+		typename std::aligned_storage<sizeof(DataType), alignof(DataType)>::type element;
+	};
+
+	Slot* _slots;
+	const IndexType _mask;
+
+	// Shared by the producers.
+	FLOW_CACHE_ALIGNED std::atomic<IndexType> _tail;
+
+	// Shared by the consumers.
+	FLOW_CACHE_ALIGNED std::atomic<IndexType> _head;
+
+	/**
+	 * \brief Claim the slot at the given counter, for a producer or a consumer.
+	 *
+	 * \param counter The tail (producers) or head (consumers) counter.
+	 * \param offset The sequence number of a claimable slot, relative to its position.
+	 * \return The claimed slot.
+	 * 		nullptr if the queue is full (producers) or empty (consumers).
+	 */
+	Slot* claim(std::atomic<IndexType>& counter, IndexType offset)
+	{
+		IndexType position = counter.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			Slot* slot = &_slots[position & _mask];
+			const Difference difference = distance(slot->sequence.load(std::memory_order_acquire),
+					static_cast<IndexType>(position + offset));
+
+			if (difference == 0)
+			{
+				if (counter.compare_exchange_weak(position, static_cast<IndexType>(position + 1),
+						std::memory_order_relaxed))
+				{
+					return slot;
+				}
+			}
+			else if (difference < 0)
+			{
+				// The slot is not yet available for this round.
+				return nullptr;
+			}
+			else
+			{
+				// Another producer or consumer claimed the slot.
+				position = counter.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	static Difference distance(IndexType sequence, IndexType index)
+	{
+		return static_cast<Difference>(sequence - index);
+	}
+};
+
+/**
+ * \brief A connection of some type from several output ports to several input ports.
+ *
+ * Every element sent is received by exactly one of the input ports, whichever asks first.
+ * The ports can be used concurrently from different threads, so several worker components
+ * can pull from one shared backlog.
+ *
+ * \note Recommendation: use Flow::connect() instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * \tparam QueueType The queue buffering the elements, see ManyToManyQueue.
+ */
+template<typename Type, typename QueueType = ManyToManyQueue<Type>>
+class ConnectionManyToMany :
+		public ConnectionOfType<Type>,
+		protected QueueType
+{
+public:
+	/**
+	 * \brief Create a connection between several output ports and several input ports.
+	 *
+	 * \param senders The output ports to be connected.
+	 * \param senderCount The number of output ports.
+	 * \param receivers The input ports to be connected.
+	 * \param receiverCount The number of input ports.
+	 * \param size The amount of elements the connection can buffer,
+	 * 		rounded up to a power of two.
+	 */
+	ConnectionManyToMany(OutPort<Type>* const senders[], size_t senderCount,
+			InPort<Type>* const receivers[], size_t receiverCount,
+			typename QueueType::Index size) :
+			QueueType(size),
+			senders(new OutPort<Type>*[senderCount]), senderCount(senderCount),
+			receivers(new InPort<Type>*[receiverCount]), receiverCount(receiverCount)
+	{
+		for (size_t i = 0; i < senderCount; i++)
+		{
+			assert(senders[i] != nullptr);
+
+			this->senders[i] = senders[i];
+			this->senders[i]->connect(this);
+		}
+
+		for (size_t i = 0; i < receiverCount; i++)
+		{
+			assert(receivers[i] != nullptr);
+
+			this->receivers[i] = receivers[i];
+			this->receivers[i]->connect(this);
+		}
+	}
+
+	ConnectionManyToMany(const ConnectionManyToMany&) = delete;
+	ConnectionManyToMany& operator=(const ConnectionManyToMany&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 */
+	virtual ~ConnectionManyToMany()
+	{
+		for (size_t i = 0; i < senderCount; i++)
+		{
+			senders[i]->disconnect();
+		}
+
+		for (size_t i = 0; i < receiverCount; i++)
+		{
+			receivers[i]->disconnect();
+		}
+
+		delete[] senders;
+		delete[] receivers;
+	}
+
+	/**
+	 * \brief Send an element over the connection.
+	 *
+	 * Can be called concurrently by all connected ports.
+	 * If the buffering capacity of the connection is full the given element is not added.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(const Type& element) final override
+	{
+		return CopyIn<Type>::send(*this, element);
+	}
+
+	/**
+	 * \brief Send an element over the connection by moving it.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(Type&& element) final override
+	{
+		return this->enqueue(std::move(element));
+	}
+
+	/**
+	 * \brief Receive an element from the connection.
+	 *
+	 * Can be called concurrently by all connected ports.
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool receive(Type& element) final override
+	{
+		return this->dequeue(element);
+	}
+
+	/**
+	 * \brief Is an element available for receiving?
+	 *
+	 * Another input port can receive it first.
+	 */
+	bool peek() const final override
+	{
+		return !this->isEmpty();
+	}
+
+	/**
+	 * \brief Is the connection full?
+	 */
+	bool full() const final override
+	{
+		return this->isFull();
+	}
+
+private:
+	OutPort<Type>** senders;
+	const size_t senderCount;
+	InPort<Type>** receivers;
+	const size_t receiverCount;
+
+	friend struct CopyIn<Type>;
+
+	bool copyIn(const Type& element)
+	{
+		return this->enqueue(element);
+	}
+};
+
+/**
+ * \brief Connect several output ports to several input ports.
+ *
+ * \tparam IndexType The unsigned type of the indices of the queue, it limits the size.
+ * \param senders The output ports to be connected.
+ * \param receivers The input ports to be connected.
+ * \param size The amount of elements the connection can buffer, rounded up to a power of two.
+ */
+template<typename IndexType = uint16_t, typename Type, size_t senderCount, size_t receiverCount>
+Connection* connect(OutPort<Type>* (&senders)[senderCount], InPort<Type>* (&receivers)[receiverCount],
+		size_t size = 1)
+{
+	assert(size <= std::numeric_limits<IndexType>::max() / 2 + 1);
+
+	return new ConnectionManyToMany<Type, ManyToManyQueue<Type, IndexType>>(senders, senderCount,
+			receivers, receiverCount, static_cast<IndexType>(size));
+}
+
+} // namespace Flow
+
+#endif /* FLOW_MANYTOMANY_H_ */
@@ -0,0 +1,490 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef FLOW_MANYTOONE_H_
+#define FLOW_MANYTOONE_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "flow.h"
+#include "utility.h"
+
+namespace Flow
+{
+
+/**
+ * \brief Implementation of a bounded multiple producer, single consumer (MPSC) queue.
+ *
+ * Any number of producers can enqueue concurrently, one consumer dequeues.
+ * Every slot carries a sequence number telling whether it is free or holds an element.
+ * A producer claims a slot by a compare-and-swap of the tail counter,
+ * constructs the element in place and publishes it by a release store of the sequence.
+ * A producer never waits for another producer, so it can also be used from an interrupt
+ * that preempts a producer (on cores with a compare-and-swap, e.g. not on a Cortex-M0).
+ *
+ * The consumer dequeues in the order the slots were claimed. When an earlier
+ * producer has not finished writing its element yet, the queue appears empty until it has.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and sequence numbers,
+ * 		the capacity is limited to half its range.
+ */
+template<typename DataType, typename IndexType = uint16_t>
+class ManyToOneQueue
+{
+	static_assert(std::is_unsigned<IndexType>::value, "The index type must be an unsigned integer type.");
+
+public:
+	/**
+	 * \brief The type of the indices and sequence numbers, the capacity.
+	 */
+	typedef IndexType Index;
+
+	/**
+	 * \brief Create a queue.
+	 *
+	 * The slots are allocated on the heap, their number is rounded up to a power of two
+	 * (of at least two).
+	 *
+	 * \param size The minimal size of the queue in number of DataType.
+	 */
+	explicit ManyToOneQueue(IndexType size) :
+			// A single slot can not tell a free slot from a full one in the next round.
+			_mask(roundUpToPowerOf2<IndexType>(size, 2) - 1),
+			_tail(0),
+			_head(0)
+	{
+		_slots = new Slot[capacity()];
+
+		for (IndexType i = 0; i < capacity(); i++)
+		{
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	ManyToOneQueue(const ManyToOneQueue&) = delete;
+	ManyToOneQueue& operator=(const ManyToOneQueue&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the remaining elements and
+	 * deallocates the slots from the heap.
+	 */
+	~ManyToOneQueue()
+	{
+		while (front() != nullptr)
+		{
+			pop();
+		}
+
+		delete[] _slots;
+	}
+
+	/**
+	 * \brief The size of the queue in number of DataType.
+	 */
+	IndexType capacity() const
+	{
+		return static_cast<IndexType>(_mask + 1);
+	}
+
+	/**
+	 * \brief Is the queue empty?
+	 *
+	 * Must be called from the consumer side.
+	 */
+	bool isEmpty() const
+	{
+		return (front() == nullptr);
+	}
+
+	/**
+	 * \brief Is the queue full?
+	 */
+	bool isFull() const
+	{
+		const IndexType tail = _tail.load(std::memory_order_relaxed);
+
+		return (distance(_slots[tail & _mask].sequence.load(std::memory_order_acquire), tail) < 0);
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType.
+	 *
+	 * Can be called concurrently by any number of producers and the consumer.
+	 * If the queue is full the given element is not added.
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(const DataType& element)
+	{
+		return emplace(element);
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType by moving it into the queue.
+	 *
+	 * If the queue is full the given element is not added (nor moved from).
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(DataType&& element)
+	{
+		return emplace(std::move(element));
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType constructed from the given arguments.
+	 *
+	 * If the queue is full no element is constructed.
+	 *
+	 * \param arguments The arguments for the constructor of DataType.
+	 * \return The element was successfully enqueued.
+	 */
+	template<typename... Arguments>
+	bool emplace(Arguments&&... arguments)
+	{
+		IndexType tail = _tail.load(std::memory_order_relaxed);
+		Slot* slot;
+
+		for (;;)
+		{
+			slot = &_slots[tail & _mask];
+			const Difference difference = distance(slot->sequence.load(std::memory_order_acquire), tail);
+
+			if (difference == 0)
+			{
+				// The slot is free, try to claim it.
+				if (_tail.compare_exchange_weak(tail, static_cast<IndexType>(tail + 1),
+						std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				// The slot still holds an element from the previous round.
+				return false;
+			}
+			else
+			{
+				// Another producer claimed the slot.
+				tail = _tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		new (&slot->element) DataType(std::forward<Arguments>(arguments)...);
+
+		slot->sequence.store(static_cast<IndexType>(tail + 1), std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * \brief Dequeue an element of DataType.
+	 *
+	 * Must be called from the single consumer.
+	 * The element is moved out of the queue.
+	 *
+	 * \param element [output] The dequeued element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully dequeued.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool dequeue(DataType& element)
+	{
+		bool success = false;
+
+		DataType* first = head();
+
+		if (first != nullptr)
+		{
+			element = std::move(*first);
+			pop();
+
+			success = true;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Access the next element to be dequeued, in place.
+	 *
+	 * Must be called from the single consumer.
+	 * The element remains in the queue until pop() is called.
+	 *
+	 * \return The next element to be dequeued.
+	 * 		nullptr if the queue is empty.
+	 */
+	const DataType* front() const
+	{
+		const Slot& slot = _slots[_head & _mask];
+
+		return (slot.sequence.load(std::memory_order_acquire) == static_cast<IndexType>(_head + 1)) ?
+				reinterpret_cast<const DataType*>(&slot.element) : nullptr;
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the queue.
+	 *
+	 * \remark Only call this after front() returned an element.
+	 */
+	void pop()
+	{
+		Slot& slot = _slots[_head & _mask];
+
+		reinterpret_cast<DataType*>(&slot.element)->~DataType();
+
+		// Hand the slot back to the producers, for the next round.
+		slot.sequence.store(static_cast<IndexType>(_head + capacity()), std::memory_order_release);
+
+		_head++;
+	}
+
+private:
+	typedef typename std::make_signed<IndexType>::type Difference;
+
+	struct Slot
+	{
+		std::atomic<IndexType> sequence;
+		typename std::aligned_storage<sizeof(DataType), alignof(DataType)>::type element;
+	};
+
+	Slot* _slots;
+	const IndexType _mask;
+
+	// Shared by the producers.
+	FLOW_CACHE_ALIGNED std::atomic<IndexType> _tail;
+
+	// Owned by the consumer.
+	FLOW_CACHE_ALIGNED IndexType _head;
+
+	DataType* head()
+	{
+		return const_cast<DataType*>(front());
+	}
+
+	static Difference distance(IndexType sequence, IndexType index)
+	{
+		return static_cast<Difference>(sequence - index);
+	}
+};
+
+/**
+ * \brief A connection of some type from several output ports to one input port.
+ *
+ * The output ports can send concurrently, from different threads or interrupts,
+ * without a Combine component in between.
+ *
+ * \note Recommendation: use Flow::connect() instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * \tparam QueueType The queue buffering the elements, see ManyToOneQueue.
+ */
+template<typename Type, typename QueueType = ManyToOneQueue<Type>>
+class ConnectionManyToOne :
+		public ConnectionOfType<Type>,
+		protected QueueType
+{
+public:
+	/**
+	 * \brief Create a connection between several output ports and an input port.
+	 *
+	 * \param senders The output ports to be connected.
+	 * \param count The number of output ports.
+	 * \param receiver The input port to be connected.
+	 * \param size The amount of elements the connection can buffer,
+	 * 		rounded up to a power of two.
+	 */
+	ConnectionManyToOne(OutPort<Type>* const senders[], size_t count, InPort<Type>& receiver,
+			typename QueueType::Index size) :
+			QueueType(size), senders(new OutPort<Type>*[count]), count(count), receiver(receiver)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			assert(senders[i] != nullptr);
+
+			this->senders[i] = senders[i];
+			this->senders[i]->connect(this);
+		}
+
+		receiver.connect(this);
+	}
+
+	ConnectionManyToOne(const ConnectionManyToOne&) = delete;
+	ConnectionManyToOne& operator=(const ConnectionManyToOne&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 */
+	virtual ~ConnectionManyToOne()
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			senders[i]->disconnect();
+		}
+
+		delete[] senders;
+
+		receiver.disconnect();
+	}
+
+	/**
+	 * \brief Send an element over the connection.
+	 *
+	 * Can be called concurrently by all connected output ports and with respect to receive().
+	 * If the buffering capacity of the connection is full the given element is not added.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(const Type& element) final override
+	{
+		return CopyIn<Type>::send(*this, element);
+	}
+
+	/**
+	 * \brief Send an element over the connection by moving it.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(Type&& element) final override
+	{
+		return this->enqueue(std::move(element));
+	}
+
+	/**
+	 * \brief Receive an element from the connection.
+	 *
+	 * Can be called concurrently with respect to send().
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool receive(Type& element) final override
+	{
+		return this->dequeue(element);
+	}
+
+	/**
+	 * \brief Access the next element to be received, in place.
+	 *
+	 * \return The next element to be received.
+	 * 		nullptr if the connection is empty.
+	 */
+	const Type* front() final override
+	{
+		return QueueType::front();
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the connection.
+	 */
+	void pop() final override
+	{
+		QueueType::pop();
+	}
+
+	/**
+	 * \brief Is an element available for receiving?
+	 */
+	bool peek() const final override
+	{
+		return !this->isEmpty();
+	}
+
+	/**
+	 * \brief Is the connection full?
+	 */
+	bool full() const final override
+	{
+		return this->isFull();
+	}
+
+private:
+	OutPort<Type>** senders;
+	const size_t count;
+	InPort<Type>& receiver;
+
+	friend struct CopyIn<Type>;
+
+	bool copyIn(const Type& element)
+	{
+		return this->enqueue(element);
+	}
+};
+
+/**
+ * \brief Connect several output ports to one input port.
+ *
+ * \tparam IndexType The unsigned type of the indices of the queue, it limits the size.
+ * \param senders The output ports to be connected.
+ * \param receiver The input port to be connected.
+ * \param size The amount of elements the connection can buffer, rounded up to a power of two.
+ */
+template<typename IndexType = uint16_t, typename Type, size_t count>
+Connection* connect(OutPort<Type>* (&senders)[count], InPort<Type>& receiver,
+		size_t size = 1)
+{
+	assert(size <= std::numeric_limits<IndexType>::max() / 2 + 1);
+
+	return new ConnectionManyToOne<Type, ManyToOneQueue<Type, IndexType>>(senders, count, receiver,
+			static_cast<IndexType>(size));
+}
+
+/**
+ * \brief Connect several output ports to one input port.
+ *
+ * \tparam IndexType The unsigned type of the indices of the queue, it limits the size.
+ * \param senders The output ports to be connected.
+ * \param receiver The input port to be connected.
+ * \param size The amount of elements the connection can buffer, rounded up to a power of two.
+ */
+template<typename IndexType = uint16_t, typename Type, size_t count>
+Connection* connect(OutPort<Type>* (&senders)[count], InPort<Type>* receiver,
+		size_t size = 1)
+{
+	assert(size <= std::numeric_limits<IndexType>::max() / 2 + 1);
+	assert(receiver != nullptr);
+
+	return new ConnectionManyToOne<Type, ManyToOneQueue<Type, IndexType>>(senders, count, *receiver,
+			static_cast<IndexType>(size));
+}
+
+} // namespace Flow
+
+#endif /* FLOW_MANYTOONE_H_ */
@@ -0,0 +1,411 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef FLOW_MULTICAST_H_
+#define FLOW_MULTICAST_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "flow.h"
+#include "utility.h"
+
+namespace Flow
+{
+
+/**
+ * \brief A connection of some type from one output port to several input ports,
+ * every input port receives every element.
+ *
+ * Unlike the Split component, an element is written once in a single ring buffer.
+ * Each input port reads it through its own cursor, the ring is shared.
+ * The output port can only overwrite an element when all input ports have read it,
+ * so the slowest input port determines whether the connection is full.
+ *
+ * The ring is an array of default constructed elements, sending assigns an element,
+ * receiving copies it. Use front() and pop() of the input port to access an element in place.
+ * The sender and each receiver can run concurrently.
+ *
+ * \note Recommendation: use Flow::connect() instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * \tparam IndexType The unsigned type of the counters, the capacity is limited to half its range.
+ */
+template<typename Type, typename IndexType = uint16_t>
+class ConnectionMulticast :
+		public ConnectionOfType<Type>
+{
+	static_assert(std::is_unsigned<IndexType>::value, "The index type must be an unsigned integer type.");
+
+public:
+	/**
+	 * \brief The type of the counters, the capacity.
+	 */
+	typedef IndexType Index;
+
+	/**
+	 * \brief Create a connection between an output port and several input ports.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param receivers The input ports to be connected.
+	 * \param count The number of input ports.
+	 * \param size The amount of elements the connection can buffer,
+	 * 		rounded up to a power of two.
+	 */
+	ConnectionMulticast(OutPort<Type>& sender, InPort<Type>* const receivers[], size_t count,
+			IndexType size) :
+			_data(new Type[roundUpToPowerOf2(size)]),
+			_mask(roundUpToPowerOf2(size) - 1),
+			_readers(new Reader[count]),
+			_count(count),
+			_enqueued(0),
+			_slowestCache(0),
+			sender(sender)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			assert(receivers[i] != nullptr);
+
+			_readers[i].attach(this, receivers[i]);
+		}
+
+		sender.connect(this);
+	}
+
+	ConnectionMulticast(const ConnectionMulticast&) = delete;
+	ConnectionMulticast& operator=(const ConnectionMulticast&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 */
+	virtual ~ConnectionMulticast()
+	{
+		sender.disconnect();
+
+		delete[] _readers;
+		delete[] _data;
+	}
+
+	/**
+	 * \brief The amount of elements the connection can buffer.
+	 */
+	IndexType capacity() const
+	{
+		return static_cast<IndexType>(_mask + 1);
+	}
+
+	/**
+	 * \brief Send an element to all input ports.
+	 *
+	 * Can be called concurrently with respect to receive() of the input ports.
+	 * If an input port still has to read the oldest element in the ring,
+	 * the given element is not added.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(const Type& element) final override
+	{
+		bool success = false;
+
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed);
+
+		if (room(enqueued) > 0)
+		{
+			_data[enqueued & _mask] = element;
+
+			_enqueued.store(static_cast<IndexType>(enqueued + 1), std::memory_order_release);
+
+			success = true;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Send an element to all input ports, by moving it into the ring.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(Type&& element) final override
+	{
+		bool success = false;
+
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed);
+
+		if (room(enqueued) > 0)
+		{
+			_data[enqueued & _mask] = std::move(element);
+
+			_enqueued.store(static_cast<IndexType>(enqueued + 1), std::memory_order_release);
+
+			success = true;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief The output port does not receive.
+	 */
+	bool receive(Type&) final override
+	{
+		return false;
+	}
+
+	/**
+	 * \brief Is an element available for all input ports?
+	 */
+	bool peek() const final override
+	{
+		bool available = (_count > 0);
+
+		for (size_t i = 0; i < _count; i++)
+		{
+			available = available && _readers[i].peek();
+		}
+
+		return available;
+	}
+
+	/**
+	 * \brief Is the connection full, does the slowest input port still have to read the whole ring?
+	 */
+	bool full() const final override
+	{
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed);
+
+		return (static_cast<IndexType>(enqueued - slowest(enqueued)) == capacity());
+	}
+
+private:
+	/**
+	 * \brief The read cursor of one input port, the connection of that port.
+	 */
+	class Reader :
+			public ConnectionOfType<Type>
+	{
+	public:
+		Reader() :
+				_connection(nullptr),
+				_receiver(nullptr),
+				_dequeued(0),
+				_enqueuedCache(0)
+		{
+		}
+
+		~Reader()
+		{
+			if (_receiver != nullptr)
+			{
+				_receiver->disconnect();
+			}
+		}
+
+		void attach(ConnectionMulticast* connection, InPort<Type>* receiver)
+		{
+			_connection = connection;
+			_receiver = receiver;
+			_receiver->connect(this);
+		}
+
+		/**
+		 * \brief The input port does not send.
+		 */
+		bool send(const Type&) final override
+		{
+			return false;
+		}
+
+		/**
+		 * \brief Receive a copy of the next element for this input port.
+		 */
+		bool receive(Type& element) final override
+		{
+			bool success = false;
+
+			const Type* next = front();
+
+			if (next != nullptr)
+			{
+				element = *next;
+				pop();
+
+				success = true;
+			}
+
+			return success;
+		}
+
+		/**
+		 * \brief Access the next element for this input port, in place.
+		 *
+		 * The element is not overwritten until pop() is called.
+		 */
+		const Type* front() final override
+		{
+			const IndexType dequeued = _dequeued.load(std::memory_order_relaxed);
+
+			return (available(dequeued) > 0) ? &_connection->_data[dequeued & _connection->_mask] : nullptr;
+		}
+
+		/**
+		 * \brief Let the output port reuse the element obtained by front().
+		 */
+		void pop() final override
+		{
+			_dequeued.store(static_cast<IndexType>(_dequeued.load(std::memory_order_relaxed) + 1),
+					std::memory_order_release);
+		}
+
+		bool peek() const final override
+		{
+			return (available(_dequeued.load(std::memory_order_relaxed)) > 0);
+		}
+
+		bool full() const final override
+		{
+			return (available(_dequeued.load(std::memory_order_relaxed)) == _connection->capacity());
+		}
+
+	private:
+		ConnectionMulticast* _connection;
+		InPort<Type>* _receiver;
+
+		// Owned by the input port, read by the output port.
+		FLOW_CACHE_ALIGNED std::atomic<IndexType> _dequeued;
+		mutable IndexType _enqueuedCache;
+
+		IndexType available(IndexType dequeued) const
+		{
+			IndexType available = static_cast<IndexType>(_enqueuedCache - dequeued);
+
+			if (available == 0)
+			{
+				_enqueuedCache = _connection->_enqueued.load(std::memory_order_acquire);
+				available = static_cast<IndexType>(_enqueuedCache - dequeued);
+			}
+
+			return available;
+		}
+
+		friend class ConnectionMulticast;
+	};
+
+	Type* const _data;
+	const IndexType _mask;
+	Reader* const _readers;
+	const size_t _count;
+
+	// Owned by the output port.
+	FLOW_CACHE_ALIGNED std::atomic<IndexType> _enqueued;
+	IndexType _slowestCache;
+
+	OutPort<Type>& sender;
+
+	/**
+	 * \brief How many elements is there room for?
+	 *
+	 * The cursors of the input ports are only scanned again
+	 * when the cached cursor of the slowest one says the ring is full.
+	 */
+	IndexType room(IndexType enqueued)
+	{
+		IndexType room = static_cast<IndexType>(capacity() - static_cast<IndexType>(enqueued - _slowestCache));
+
+		if (room == 0)
+		{
+			_slowestCache = slowest(enqueued);
+			room = static_cast<IndexType>(capacity() - static_cast<IndexType>(enqueued - _slowestCache));
+		}
+
+		return room;
+	}
+
+	/**
+	 * \brief The cursor of the input port that is furthest behind.
+	 */
+	IndexType slowest(IndexType enqueued) const
+	{
+		IndexType slowest = enqueued;
+
+		for (size_t i = 0; i < _count; i++)
+		{
+			const IndexType dequeued = _readers[i]._dequeued.load(std::memory_order_acquire);
+
+			if (static_cast<IndexType>(enqueued - dequeued) > static_cast<IndexType>(enqueued - slowest))
+			{
+				slowest = dequeued;
+			}
+		}
+
+		return slowest;
+	}
+};
+
+/**
+ * \brief Connect an output port to several input ports, each receiving every element.
+ *
+ * \tparam IndexType The unsigned type of the counters of the ring, it limits the size.
+ * \param sender The output port to be connected.
+ * \param receivers The input ports to be connected.
+ * \param size The amount of elements the connection can buffer, rounded up to a power of two.
+ */
+template<typename IndexType = uint16_t, typename Type, size_t count>
+Connection* connect(OutPort<Type>& sender, InPort<Type>* (&receivers)[count],
+		size_t size = 1)
+{
+	assert(size <= std::numeric_limits<IndexType>::max() / 2 + 1);
+
+	return new ConnectionMulticast<Type, IndexType>(sender, receivers, count,
+			static_cast<IndexType>(size));
+}
+
+/**
+ * \brief Connect an output port to several input ports, each receiving every element.
+ *
+ * \tparam IndexType The unsigned type of the counters of the ring, it limits the size.
+ * \param sender The output port to be connected.
+ * \param receivers The input ports to be connected.
+ * \param size The amount of elements the connection can buffer, rounded up to a power of two.
+ */
+template<typename IndexType = uint16_t, typename Type, size_t count>
+Connection* connect(OutPort<Type>* sender, InPort<Type>* (&receivers)[count],
+		size_t size = 1)
+{
+	assert(size <= std::numeric_limits<IndexType>::max() / 2 + 1);
+	assert(sender != nullptr);
+
+	return new ConnectionMulticast<Type, IndexType>(*sender, receivers, count,
+			static_cast<IndexType>(size));
+}
+
+} // namespace Flow
+
+#endif /* FLOW_MULTICAST_H_ */
@@ -0,0 +1,280 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#ifndef FLOW_OVERWRITE_H_
+#define FLOW_OVERWRITE_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <limits>
+#include <type_traits>
+
+#include "flow.h"
+#include "utility.h"
+
+namespace Flow
+{
+
+/**
+ * \brief A lossy connection of some type between component ports,
+ * that keeps the most recent elements.
+ *
+ * When the connection is full, sending overwrites the oldest element instead of failing.
+ * Sending never blocks nor fails, a slow receiver gets the freshest elements
+ * and overwritten() tells how many it missed.
+ *
+ * Each slot of the ring carries a sequence number, odd while the sender is writing it.
+ * The receiver copies an element and checks the sequence number did not change meanwhile,
+ * otherwise the element was overwritten and is skipped. The sender and receiver
+ * can run concurrently, neither of them waits for the other.
+ * Because an element can be overwritten while it is being copied out,
+ * Type has to be trivially copyable.
+ *
+ * \note Recommendation: use Flow::connect() instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * The counters and the sequence numbers are at least 32 bits wide, whatever the IndexType:
+ * a receiver would have to be lapped 2^31 times in between two loads
+ * to mistake a newer element for the one it expects.
+ *
+ * \tparam IndexType The unsigned type of the capacity.
+ */
+template<typename Type, typename IndexType = uint32_t>
+class ConnectionOverwrite :
+		public ConnectionOfType<Type>
+{
+	static_assert(std::is_trivially_copyable<Type>::value, "A lossy connection copies elements that may be overwritten.");
+	static_assert(std::is_unsigned<IndexType>::value, "The index type must be an unsigned integer type.");
+
+public:
+	/**
+	 * \brief The type of the capacity.
+	 */
+	typedef IndexType Index;
+
+	/**
+	 * \brief The type of the counters and sequence numbers, at least 32 bits wide.
+	 */
+	typedef typename std::conditional<(sizeof(IndexType) > sizeof(uint32_t)), IndexType, uint32_t>::type Counter;
+
+	/**
+	 * \brief Create a connection between an output and input port.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param receiver The input port to be connected.
+	 * \param size The amount of most recent elements the connection keeps,
+	 * 		rounded up to a power of two.
+	 */
+	ConnectionOverwrite(OutPort<Type>& sender, InPort<Type>& receiver, IndexType size) :
+			_mask(roundUpToPowerOf2(size) - 1),
+			_enqueued(0),
+			_dequeued(0),
+			_overwritten(0),
+			sender(sender),
+			receiver(receiver)
+	{
+		_slots = new Slot[capacity()];
+
+		for (IndexType i = 0; i < capacity(); i++)
+		{
+			// No position has this sequence number yet.
+			_slots[i].sequence.store(1, std::memory_order_relaxed);
+		}
+
+		sender.connect(this);
+		receiver.connect(this);
+	}
+
+	ConnectionOverwrite(const ConnectionOverwrite&) = delete;
+	ConnectionOverwrite& operator=(const ConnectionOverwrite&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 */
+	virtual ~ConnectionOverwrite()
+	{
+		sender.disconnect();
+		receiver.disconnect();
+
+		delete[] _slots;
+	}
+
+	/**
+	 * \brief The amount of most recent elements the connection keeps.
+	 */
+	IndexType capacity() const
+	{
+		return static_cast<IndexType>(_mask + 1);
+	}
+
+	/**
+	 * \brief Send an element over the connection.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 * If the connection is full the oldest element is overwritten.
+	 *
+	 * \param element The element to be sent.
+	 * \return Always true.
+	 */
+	bool send(const Type& element) final override
+	{
+		const Counter position = _enqueued.load(std::memory_order_relaxed);
+		Slot& slot = _slots[position & _mask];
+
+		slot.sequence.store(static_cast<Counter>(2 * position + 1), std::memory_order_relaxed);
+		// The receiver has to see the odd sequence number before any of the new element.
+		std::atomic_thread_fence(std::memory_order_release);
+
+		memcpy(&slot.element, &element, sizeof(Type));
+
+		slot.sequence.store(static_cast<Counter>(2 * position + 2), std::memory_order_release);
+		_enqueued.store(static_cast<Counter>(position + 1), std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * \brief Receive the oldest element still in the connection.
+	 *
+	 * Can be called concurrently with respect to send().
+	 * The number of elements that were overwritten before this one
+	 * is available by overwritten() afterwards.
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 * 		Thus the element output parameter has a valid value.
+	 */
+	bool receive(Type& element) final override
+	{
+		Counter lost = 0;
+
+		for (;;)
+		{
+			const Counter enqueued = _enqueued.load(std::memory_order_acquire);
+			const Counter behind = static_cast<Counter>(enqueued - _dequeued);
+
+			if (behind == 0)
+			{
+				return false;
+			}
+
+			if (behind > capacity())
+			{
+				// The sender went around the ring, skip the overwritten elements.
+				lost = static_cast<Counter>(lost + behind - capacity());
+				_dequeued = static_cast<Counter>(enqueued - capacity());
+			}
+
+			const Slot& slot = _slots[_dequeued & _mask];
+			const Counter sequence = slot.sequence.load(std::memory_order_acquire);
+
+			if (sequence == static_cast<Counter>(2 * _dequeued + 2))
+			{
+				memcpy(&element, &slot.element, sizeof(Type));
+				// The copy has to complete before the sequence number is checked again.
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+				{
+					_dequeued++;
+					_overwritten = lost;
+
+					return true;
+				}
+			}
+
+			// The sender is overwriting this element.
+			lost++;
+			_dequeued++;
+		}
+	}
+
+	/**
+	 * \brief The number of elements overwritten just before the element last received.
+	 */
+	size_t overwritten() const final override
+	{
+		return _overwritten;
+	}
+
+	/**
+	 * \brief Is an element available for receiving?
+	 */
+	bool peek() const final override
+	{
+		return (_enqueued.load(std::memory_order_acquire) != _dequeued);
+	}
+
+	/**
+	 * \brief A lossy connection is never full for the sender.
+	 */
+	bool full() const final override
+	{
+		return false;
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<Counter> sequence;
+		typename std::aligned_storage<sizeof(Type), alignof(Type)>::type element;
+	};
+
+	Slot* _slots;
+	const IndexType _mask;
+
+	// Owned by the sender.
+	FLOW_CACHE_ALIGNED std::atomic<Counter> _enqueued;
+
+	// Owned by the receiver.
+	FLOW_CACHE_ALIGNED Counter _dequeued;
+	size_t _overwritten;
+
+	OutPort<Type>& sender;
+	InPort<Type>& receiver;
+};
+
+/**
+ * \brief Connect an output port to an input port by a lossy connection,
+ * that overwrites the oldest element when full.
+ *
+ * \tparam IndexType The unsigned type of the capacity.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ * \param size The amount of most recent elements the connection keeps, rounded up to a power of two.
+ */
+template<typename IndexType = uint32_t, typename Type>
+Connection* connectOverwrite(OutPort<Type>& sender, InPort<Type>& receiver, size_t size = 1)
+{
+	assert(size <= std::numeric_limits<IndexType>::max() / 2 + 1);
+
+	return new ConnectionOverwrite<Type, IndexType>(sender, receiver, static_cast<IndexType>(size));
+}
+
+} // namespace Flow
+
+#endif /* FLOW_OVERWRITE_H_ */
@@ -24,8 +24,16 @@
 #ifndef FLOW_POOL_H_
 #define FLOW_POOL_H_
 
+#include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
 #include "queue.h"
 
 /**
@@ -35,133 +43,1434 @@ namespace Flow
 {
 
 /**
- * \brief A pool of DataType elements.
+ * \brief The free-list of a pool handing out the element released longest ago first.
  *
- * A pool can be used to effectively pass big data structures through connections between components.
- * An element can be taken from the pool and passed around by reference.
- * When taking an element the new owner is responsible to give it back to the pool at some point.
+ * A Queue of indices: take() and release() can be called concurrently,
+ * by one taker and one releaser.
  *
- * A pool is thread safe in the sense that the take() and release() can be called concurrently.
+ * \tparam IndexType The unsigned type of the indices, it limits the size of the pool.
  */
-template<typename DataType>
-class Pool
+template<typename IndexType = uint16_t>
+class FifoFreeList
 {
+public:
+	typedef IndexType Index;
+
+	/**
+	 * \brief Create a free-list holding all indices of a pool of the given size.
+	 */
+	explicit FifoFreeList(IndexType size) :
+			_free(size)
+	{
+		for (IndexType i = 0; i < size; i++)
+		{
+			_free.enqueue(i);
+		}
+	}
+
+	/**
+	 * \brief Is the free-list empty?
+	 */
+	bool isEmpty() const
+	{
+		return _free.isEmpty();
+	}
+
+	/**
+	 * \brief Take the first free index.
+	 */
+	bool pop(IndexType& index)
+	{
+		return _free.dequeue(index);
+	}
+
+	/**
+	 * \brief Add a free index.
+	 */
+	bool push(IndexType index)
+	{
+		return _free.enqueue(index);
+	}
+
+	/**
+	 * \brief Take a number of free indices in one go.
+	 *
+	 * \return The number of indices taken.
+	 */
+	IndexType pop(IndexType* indices, IndexType count)
+	{
+		return _free.dequeue(indices, count);
+	}
+
+	/**
+	 * \brief Add a number of free indices in one go.
+	 */
+	void push(const IndexType* indices, IndexType count)
+	{
+		_free.enqueue(indices, count);
+	}
+
 private:
-	uint16_t _size;
-	DataType* _data;
-	Queue<DataType*> _available;
+	Queue<IndexType, IndexType> _free;
+};
 
+/**
+ * \brief The free-list of a StaticPool handing out the element released longest ago first.
+ *
+ * Like FifoFreeList, but a StaticQueue of indices: no heap is involved.
+ *
+ * \tparam size The size of the pool in number of elements.
+ * \tparam IndexType The unsigned type of the indices,
+ * 		by default the smallest type that can hold the size.
+ */
+template<size_t size, typename IndexType = typename SmallestIndex<size>::type>
+class StaticFifoFreeList
+{
 public:
+	typedef IndexType Index;
+
 	/**
-	 * \brief Create a heap.
-	 *
-	 * The array of DataType will be allocated on the heap.
+	 * \brief Create a free-list holding all indices of the pool.
+	 */
+	StaticFifoFreeList()
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			_free.enqueue(static_cast<IndexType>(i));
+		}
+	}
+
+	/**
+	 * \brief Is the free-list empty?
+	 */
+	bool isEmpty() const
+	{
+		return _free.isEmpty();
+	}
+
+	/**
+	 * \brief Take the first free index.
+	 */
+	bool pop(IndexType& index)
+	{
+		return _free.dequeue(index);
+	}
+
+	/**
+	 * \brief Add a free index.
+	 */
+	bool push(IndexType index)
+	{
+		return _free.enqueue(index);
+	}
+
+	/**
+	 * \brief Take a number of free indices in one go.
 	 *
-	 * \param size The size of the pool in number of DataType.
+	 * \return The number of indices taken.
 	 */
-	explicit Pool(uint16_t size) :
-			_size(size),
-			_data(new DataType[_size]),
-			_available(Queue<DataType*>(_size))
+	IndexType pop(IndexType* indices, IndexType count)
+	{
+		return _free.dequeue(indices, count);
+	}
+
+	/**
+	 * \brief Add a number of free indices in one go.
+	 */
+	void push(const IndexType* indices, IndexType count)
+	{
+		_free.enqueue(indices, count);
+	}
+
+private:
+	StaticQueue<IndexType, size, IndexType> _free;
+};
+
+/**
+ * \brief Implementation of the free-list of a pool handing out the element released most recently first,
+ * independent of where the links are stored.
+ *
+ * The element released last is most likely still in the data cache,
+ * taking it again avoids the cache misses of a cold element.
+ *
+ * A lock-free Treiber stack, linked by indices: take() and release() can be called
+ * concurrently, by any number of threads. The top of the stack is an index
+ * together with a tag counting its modifications, both swapped in one compare-exchange,
+ * so a pop that was overtaken by other pops and pushes of the same element fails.
+ * The tag takes the bits of the top the index leaves: the top is 32 bits wide for 8 and 16-bit indices,
+ * so it can be compare-exchanged on a 32-bit core, and 64 bits wide for 32-bit indices.
+ * A pop can only succeed wrongly (ABA) when it was overtaken by exactly a multiple of
+ * 2^24, 2^16 or 2^32 modifications respectively.
+ *
+ * The compare-exchange of the top has to be lock-free, also to be used from an interrupt:
+ * the free-list cannot be used on a core without one (e.g. a Cortex-M0),
+ * nor with 32-bit indices on a 32-bit core.
+ *
+ * The Derived class provides the links, see LifoFreeList and StaticLifoFreeList.
+ * It has to implement:
+ * - std::atomic<IndexType>* links(): per index, the index below it on the stack.
+ *
+ * \tparam IndexType The unsigned type of the indices, it limits the size of the pool.
+ */
+template<typename IndexType, typename Derived>
+class LifoFreeListBase
+{
+	static_assert(sizeof(IndexType) <= sizeof(uint32_t), "The index and the tag have to fit in 64 bits.");
+
+public:
+	typedef IndexType Index;
+
+	/**
+	 * \brief Is the free-list empty?
+	 */
+	bool isEmpty() const
+	{
+		return index(_top.load(std::memory_order_relaxed)) == NIL;
+	}
+
+	/**
+	 * \brief Take the most recently pushed index.
+	 */
+	bool pop(IndexType& popped)
 	{
-		for (uint_fast16_t i = 0; i < _size; i++)
+		Top top = _top.load(std::memory_order_acquire);
+
+		while (index(top) != NIL)
 		{
-			_available.enqueue(&_data[i]);
+			const IndexType next = derived().links()[index(top)].load(std::memory_order_relaxed);
+
+			if (_top.compare_exchange_weak(top, pack(next, tag(top) + 1),
+					std::memory_order_acquire, std::memory_order_acquire))
+			{
+				popped = index(top);
+				return true;
+			}
 		}
+
+		return false;
 	}
 
 	/**
-	 * \brief Copy constructor.
+	 * \brief Add a free index on top.
+	 */
+	bool push(IndexType pushed)
+	{
+		Top top = _top.load(std::memory_order_relaxed);
+
+		do
+		{
+			derived().links()[pushed].store(index(top), std::memory_order_relaxed);
+		}
+		while (!_top.compare_exchange_weak(top, pack(pushed, tag(top) + 1),
+				std::memory_order_release, std::memory_order_relaxed));
+
+		return true;
+	}
+
+	/**
+	 * \brief Take a number of the most recently pushed indices in one go.
 	 *
-	 * Performs a complete, deep copy of the given pool.
-	 * The array of DataType will be allocated on the heap.
+	 * The chain is walked from the top and cut off by a single compare-exchange,
+	 * any concurrent pop or push in between changes the tag and makes it retry.
 	 *
-	 * \param other Pool to be copied.
+	 * \return The number of indices taken.
 	 */
-	explicit Pool(const Pool<DataType>& other) :
-			_size(other._size),
-			_data(new DataType[_size]),
-			_available(other._available)
+	IndexType pop(IndexType* popped, IndexType count)
 	{
-		for (uint_fast16_t i = 0; i < _size; i++)
+		Top top = _top.load(std::memory_order_acquire);
+		IndexType taken = 0;
+		bool done = false;
+
+		while (!done)
 		{
-			_data[i] = other._data[i];
+			IndexType cursor = index(top);
+			taken = 0;
+
+			while ((taken < count) && (cursor != NIL))
+			{
+				popped[taken++] = cursor;
+				cursor = derived().links()[cursor].load(std::memory_order_relaxed);
+			}
+
+			done = (taken == 0) || _top.compare_exchange_weak(top, pack(cursor, tag(top) + 1),
+					std::memory_order_acquire, std::memory_order_acquire);
+		}
+
+		return taken;
+	}
+
+	/**
+	 * \brief Add a number of free indices in one go, as if pushed one by one: the last one ends up on top.
+	 *
+	 * The indices are linked up front, the chain is put on top by a single compare-exchange.
+	 */
+	void push(const IndexType* pushed, IndexType count)
+	{
+		if (count > 0)
+		{
+			std::atomic<IndexType>* links = derived().links();
+
+			for (IndexType i = 1; i < count; i++)
+			{
+				links[pushed[i]].store(pushed[i - 1], std::memory_order_relaxed);
+			}
+
+			Top top = _top.load(std::memory_order_relaxed);
+
+			do
+			{
+				links[pushed[0]].store(index(top), std::memory_order_relaxed);
+			}
+			while (!_top.compare_exchange_weak(top, pack(pushed[count - 1], tag(top) + 1),
+					std::memory_order_release, std::memory_order_relaxed));
 		}
 	}
 
+protected:
+	typedef typename std::conditional<(sizeof(IndexType) <= sizeof(uint16_t)), uint32_t, uint64_t>::type Top;
+
+#if defined(__cpp_lib_atomic_is_always_lock_free)
+	static_assert(std::atomic<Top>::is_always_lock_free, "The top of the stack has to be lock-free.");
+#else
+	static_assert((sizeof(Top) == sizeof(uint32_t)) ? (ATOMIC_INT_LOCK_FREE == 2) : (ATOMIC_LLONG_LOCK_FREE == 2),
+			"The top of the stack has to be lock-free.");
+#endif
+
+	static const IndexType NIL = std::numeric_limits<IndexType>::max();
+	static const unsigned int BITS = std::numeric_limits<IndexType>::digits;
+
+	// The index of the top element in the low bits, the tag in the high bits.
+	std::atomic<Top> _top;
+
+	LifoFreeListBase() :
+			_top(pack(NIL, 0))
+	{
+	}
+
 	/**
-	 * \brief Assignment operator.
+	 * \brief Link all indices of a pool of the given size, the first one on top.
 	 */
-	Pool& operator=(const Pool<DataType>& other)
+	void link(size_t size)
 	{
-		Pool<DataType> shadow(other);
-		*this = std::move(shadow);
-		return *this;
+		std::atomic<IndexType>* links = derived().links();
+
+		for (size_t i = 0; i < size; i++)
+		{
+			links[i].store((i + 1 < size) ? static_cast<IndexType>(i + 1) : NIL,
+					std::memory_order_relaxed);
+		}
+
+		_top.store(pack(size > 0 ? 0 : NIL, 0), std::memory_order_relaxed);
 	}
 
 	/**
-	 * \brief Move operator.
+	 * \brief Copy the stack of the other free-list, not to be used concurrently with either free-list.
 	 */
-	Pool& operator=(Pool<DataType>&& other) noexcept
+	void copy(const Derived& other, size_t size)
 	{
-		if(this != &other)
+		std::atomic<IndexType>* links = derived().links();
+
+		for (size_t i = 0; i < size; i++)
 		{
-			delete[] _data;
-			_data = other._data;
-			other._data = nullptr;
-			_size = other._size;
-			_available = other._available;
+			links[i].store(other.links()[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
 		}
 
-		return *this;
+		_top.store(other._top.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+private:
+	static Top pack(IndexType index, Top tag)
+	{
+		return static_cast<Top>((tag << BITS) | index);
+	}
+
+	static IndexType index(Top top)
+	{
+		return static_cast<IndexType>(top);
 	}
 
+	static Top tag(Top top)
+	{
+		return static_cast<Top>(top >> BITS);
+	}
+
+	Derived& derived()
+	{
+		return *static_cast<Derived*>(this);
+	}
+};
+
+template<typename IndexType, typename Derived>
+const IndexType LifoFreeListBase<IndexType, Derived>::NIL;
+
+template<typename IndexType, typename Derived>
+const unsigned int LifoFreeListBase<IndexType, Derived>::BITS;
+
+/**
+ * \brief The free-list of a pool handing out the element released most recently first.
+ *
+ * The links are allocated on the heap, see LifoFreeListBase.
+ *
+ * \tparam IndexType The unsigned type of the indices, it limits the size of the pool.
+ */
+template<typename IndexType = uint16_t>
+class LifoFreeList :
+		public LifoFreeListBase<IndexType, LifoFreeList<IndexType>>
+{
+private:
+	typedef LifoFreeListBase<IndexType, LifoFreeList> Base;
+
+	friend Base;
+
+	IndexType _size;
+	std::atomic<IndexType>* _next;
+
+public:
 	/**
-	 * \brief Destructor.
-	 *
-	 * Deallocates the array of DataType from the heap.
+	 * \brief Create a free-list holding all indices of a pool of the given size.
 	 */
-	~Pool()
+	explicit LifoFreeList(IndexType size) :
+			_size(size),
+			_next(new std::atomic<IndexType>[size])
 	{
-		delete[] _data;
+		assert(size < Base::NIL);
+
+		this->link(_size);
 	}
 
 	/**
-	 * \brief Is an element available in the pool?
+	 * \brief Copy constructor, not to be used concurrently with the other free-list.
 	 */
-	bool haveAvailable() const
+	LifoFreeList(const LifoFreeList& other) :
+			Base(),
+			_size(other._size),
+			_next(new std::atomic<IndexType>[other._size])
 	{
-		return !_available.isEmpty();
+		this->copy(other, _size);
 	}
 
 	/**
-	 * \brief Take an element from the pool.
-	 *
-	 * When an element is taken from the pool, the new "owner" is responsible
-	 * to release it back into the pool when it is no longer needed.
-	 *
-	 * \return Pointer to an element if the pool had one available.
-	 * 		nullptr if no element was available.
+	 * \brief Assignment operator, not to be used concurrently with either free-list.
 	 */
-	DataType* take()
+	LifoFreeList& operator=(const LifoFreeList& other)
+	{
+		if (this != &other)
+		{
+			LifoFreeList copy(other);
+			std::swap(_size, copy._size);
+			std::swap(_next, copy._next);
+			this->_top.store(copy._top.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		return *this;
+	}
+
+	/**
+	 * \brief Destructor.
+	 */
+	~LifoFreeList()
 	{
-		DataType* take = nullptr;
+		delete[] _next;
+	}
+
+private:
+	std::atomic<IndexType>* links()
+	{
+		return _next;
+	}
+
+	const std::atomic<IndexType>* links() const
+	{
+		return _next;
+	}
+};
+
+/**
+ * \brief The free-list of a StaticPool handing out the element released most recently first.
+ *
+ * Like LifoFreeList, but the links are part of the free-list itself: no heap is involved.
+ * A small index type also keeps the top of the stack 32 bits wide, see LifoFreeListBase.
+ *
+ * \tparam size The size of the pool in number of elements.
+ * \tparam IndexType The unsigned type of the indices,
+ * 		by default the smallest type that can hold the size.
+ */
+template<size_t size, typename IndexType = typename SmallestIndex<size>::type>
+class StaticLifoFreeList :
+		public LifoFreeListBase<IndexType, StaticLifoFreeList<size, IndexType>>
+{
+	// The maximum value of IndexType marks the bottom of the stack, it is never an index.
+	static_assert(size <= std::numeric_limits<IndexType>::max(), "The index type cannot hold the size.");
+
+private:
+	typedef LifoFreeListBase<IndexType, StaticLifoFreeList> Base;
+
+	friend Base;
 
-		_available.dequeue(take);
+	std::atomic<IndexType> _next[size];
 
-		return take;
+public:
+	/**
+	 * \brief Create a free-list holding all indices of the pool.
+	 */
+	StaticLifoFreeList()
+	{
+		this->link(size);
 	}
 
 	/**
-	 * \brief Release an element into the pool.
-	 *
-	 * \param element The element to be released into the pool.
-	 * \return The element was successfully put in the pool.
-	 * 		When not successful the take-release mechanism was violated.
+	 * \brief Copy constructor, not to be used concurrently with the other free-list.
 	 */
-	bool release(DataType& element)
+	StaticLifoFreeList(const StaticLifoFreeList& other) :
+			Base()
+	{
+		this->copy(other, size);
+	}
+
+	/**
+	 * \brief Assignment operator, not to be used concurrently with either free-list.
+	 */
+	StaticLifoFreeList& operator=(const StaticLifoFreeList& other)
+	{
+		if (this != &other)
+		{
+			this->copy(other, size);
+		}
+
+		return *this;
+	}
+
+private:
+	std::atomic<IndexType>* links()
+	{
+		return _next;
+	}
+
+	const std::atomic<IndexType>* links() const
+	{
+		return _next;
+	}
+};
+
+/**
+ * \brief Implementation of a pool of DataType elements, independent of where the elements are stored.
+ *
+ * A pool can be used to effectively pass big data structures through connections between components.
+ * An element can be taken from the pool and passed around by reference.
+ * When taking an element the new owner is responsible to give it back to the pool at some point.
+ *
+ * A pool is thread safe in the sense that the take() and release() can be called concurrently.
+ * Which element is taken next is up to the free-list: a FIFO free-list hands out
+ * the element released longest ago, a LIFO free-list the one released most recently,
+ * which is likely still cache-warm. With a LIFO free-list any number of threads
+ * can take and release concurrently.
+ *
+ * The Derived class provides the storage, see Pool and StaticPool.
+ * It has to implement:
+ * - Index capacity() const: the size of the pool in number of DataType.
+ * - DataType* storage(): the first element of the storage.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam FreeListType The free-list, holding the indices of the available elements.
+ */
+template<typename DataType, typename FreeListType, typename Derived>
+class PoolBase
+{
+public:
+	/**
+	 * \brief The type of the elements.
+	 */
+	typedef DataType Element;
+
+	/**
+	 * \brief The free-list, holding the indices of the available elements.
+	 */
+	typedef FreeListType FreeList;
+
+	/**
+	 * \brief The type of the indices, it limits the size of the pool.
+	 */
+	typedef typename FreeListType::Index Index;
+
+	/**
+	 * \brief Is an element available in the pool?
+	 */
+	bool haveAvailable() const
+	{
+		return !_available.isEmpty();
+	}
+
+	/**
+	 * \brief Take an element from the pool.
+	 *
+	 * When an element is taken from the pool, the new "owner" is responsible
+	 * to release it back into the pool when it is no longer needed.
+	 *
+	 * \return Pointer to an element if the pool had one available.
+	 * 		nullptr if no element was available.
+	 */
+	DataType* take()
+	{
+		Index index;
+
+		return _available.pop(index) ? &derived().storage()[index] : nullptr;
+	}
+
+	/**
+	 * \brief Release an element into the pool.
+	 *
+	 * \param element The element to be released into the pool.
+	 * \return The element was successfully put in the pool.
+	 * 		When not successful the take-release mechanism was violated.
+	 */
+	bool release(DataType& element)
+	{
+		return contains(element)
+				&& _available.push(static_cast<Index>(&element - derived().storage()));
+	}
+
+	/**
+	 * \brief Take a number of elements from the pool in one go.
+	 *
+	 * With a LIFO free-list up to BATCH elements are taken by a single atomic operation.
+	 *
+	 * \param elements [output] Pointers to the elements taken.
+	 * \param count The maximum number of elements to take.
+	 * \return The number of elements taken.
+	 */
+	size_t take(DataType** elements, size_t count)
+	{
+		DataType* data = derived().storage();
+		Index indices[BATCH];
+		size_t taken = 0;
+		bool more = true;
+
+		while (more && (taken < count))
+		{
+			const Index batch = static_cast<Index>(std::min<size_t>(count - taken, BATCH));
+			const Index popped = _available.pop(indices, batch);
+
+			for (Index i = 0; i < popped; i++)
+			{
+				elements[taken + i] = &data[indices[i]];
+			}
+
+			taken += popped;
+			more = (popped == batch);
+		}
+
+		return taken;
+	}
+
+	/**
+	 * \brief Release a number of elements into the pool in one go.
+	 *
+	 * \remark All elements have to be taken from this pool.
+	 *
+	 * \param elements Pointers to the elements to be released.
+	 * \param count The number of elements.
+	 */
+	void release(DataType* const* elements, size_t count)
+	{
+		const DataType* data = derived().storage();
+		Index indices[BATCH];
+		size_t released = 0;
+
+		while (released < count)
+		{
+			const Index batch = static_cast<Index>(std::min<size_t>(count - released, BATCH));
+
+			for (Index i = 0; i < batch; i++)
+			{
+				assert(contains(*elements[released + i]));
+				indices[i] = static_cast<Index>(elements[released + i] - data);
+			}
+
+			_available.push(indices, batch);
+			released += batch;
+		}
+	}
+
+	/**
+	 * \brief Is the element part of this pool?
+	 */
+	bool contains(const DataType& element) const
+	{
+		const DataType* data = derived().storage();
+
+		return (&element >= data) && (&element < data + derived().capacity());
+	}
+
+protected:
+	FreeListType _available;
+
+	PoolBase() = default;
+
+	explicit PoolBase(Index size) :
+			_available(size)
+	{
+	}
+
+private:
+	// The number of elements moved per atomic operation by the batch take() and release().
+	static const size_t BATCH = 32;
+
+	Derived& derived()
+	{
+		return *static_cast<Derived*>(this);
+	}
+
+	const Derived& derived() const
+	{
+		return *static_cast<const Derived*>(this);
+	}
+};
+
+template<typename DataType, typename FreeListType, typename Derived>
+const size_t PoolBase<DataType, FreeListType, Derived>::BATCH;
+
+/**
+ * \brief A pool of DataType elements.
+ *
+ * The size is chosen at runtime, the array of DataType is allocated on the heap.
+ * See PoolBase.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam FreeListType The free-list, FifoFreeList or LifoFreeList.
+ */
+template<typename DataType, typename FreeListType = FifoFreeList<uint16_t>>
+class Pool :
+		public PoolBase<DataType, FreeListType, Pool<DataType, FreeListType>>
+{
+private:
+	typedef PoolBase<DataType, FreeListType, Pool> Base;
+
+	friend Base;
+
+	typename Base::Index _size;
+	DataType* _data;
+
+public:
+	typedef typename Base::Index Index;
+
+	/**
+	 * \brief Create a heap.
+	 *
+	 * The array of DataType will be allocated on the heap.
+	 *
+	 * \param size The size of the pool in number of DataType.
+	 */
+	explicit Pool(Index size) :
+			Base(size),
+			_size(size),
+			_data(new DataType[_size])
+	{
+	}
+
+	/**
+	 * \brief Copy constructor.
+	 *
+	 * Performs a complete, deep copy of the given pool.
+	 * The array of DataType will be allocated on the heap.
+	 *
+	 * \param other Pool to be copied.
+	 */
+	explicit Pool(const Pool& other) :
+			Base(other),
+			_size(other._size),
+			_data(new DataType[_size])
+	{
+		for (uint_fast32_t i = 0; i < _size; i++)
+		{
+			_data[i] = other._data[i];
+		}
+	}
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	Pool& operator=(const Pool& other)
+	{
+		Pool shadow(other);
+		*this = std::move(shadow);
+		return *this;
+	}
+
+	/**
+	 * \brief Move operator.
+	 */
+	Pool& operator=(Pool&& other) noexcept
+	{
+		if(this != &other)
+		{
+			delete[] _data;
+			_data = other._data;
+			other._data = nullptr;
+			_size = other._size;
+			this->_available = other._available;
+		}
+
+		return *this;
+	}
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Deallocates the array of DataType from the heap.
+	 */
+	~Pool()
+	{
+		delete[] _data;
+	}
+
+private:
+	Index capacity() const
+	{
+		return _size;
+	}
+
+	DataType* storage()
+	{
+		return _data;
+	}
+
+	const DataType* storage() const
+	{
+		return _data;
+	}
+};
+
+/**
+ * \brief A pool of DataType elements with a size known at compile time.
+ *
+ * The array of DataType and the free-list are part of the pool itself, no heap is involved.
+ * A StaticPool with static storage duration ends up in .data or .bss,
+ * where the linker accounts for it. The indices are of the smallest type that can hold the size.
+ * See PoolBase.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam size The size of the pool in number of DataType.
+ * \tparam FreeListType The free-list, StaticFifoFreeList<size> or StaticLifoFreeList<size>.
+ */
+template<typename DataType, size_t size, typename FreeListType = StaticFifoFreeList<size>>
+class StaticPool :
+		public PoolBase<DataType, FreeListType, StaticPool<DataType, size, FreeListType>>
+{
+	static_assert(size > 0, "A pool must be able to hold at least one element.");
+	static_assert(size <= std::numeric_limits<typename FreeListType::Index>::max(),
+			"The index type cannot hold the size.");
+
+private:
+	typedef PoolBase<DataType, FreeListType, StaticPool> Base;
+
+	friend Base;
+
+	DataType _data[size];
+
+public:
+	typedef typename Base::Index Index;
+
+	/**
+	 * \brief Create a pool.
+	 */
+	StaticPool() = default;
+
+private:
+	static constexpr Index capacity()
+	{
+		return size;
+	}
+
+	DataType* storage()
+	{
+		return _data;
+	}
+
+	const DataType* storage() const
+	{
+		return _data;
+	}
+};
+
+/**
+ * \brief A pool of buffers of different sizes, for messages of variable length.
+ *
+ * The buffers are divided in size classes: class c holds buffers of smallestSize << c bytes.
+ * A buffer is taken from the smallest class that fits the requested size,
+ * when that class has none available from the next larger one. Taking and releasing
+ * touch at most a few classes, independent of the number of buffers.
+ * Compared to a Pool of buffers of the maximum size, short messages
+ * no longer occupy a big buffer.
+ *
+ * Each class has its own free-list, with the same guarantees as the free-list of a Pool:
+ * with a FifoFreeList (the default) one taker and one releaser can access the pool concurrently,
+ * with a LifoFreeList any number of threads.
+ *
+ * A buffer is aligned to its size, up to alignof(std::max_align_t).
+ *
+ * \tparam smallestSize The size of the buffers of the smallest class in bytes, a power of two.
+ * \tparam classes The number of size classes.
+ * \tparam FreeListType The free-list of each class, FifoFreeList or LifoFreeList.
+ */
+template<size_t smallestSize, size_t classes, typename FreeListType = FifoFreeList<uint16_t>>
+class SlabPool
+{
+	static_assert((smallestSize > 0) && ((smallestSize & (smallestSize - 1)) == 0),
+			"The smallest size must be a power of two.");
+	static_assert(classes > 0, "A slab pool has at least one size class.");
+
+public:
+	typedef typename FreeListType::Index Index;
+
+	/**
+	 * \brief Create a slab pool.
+	 *
+	 * The buffers of each class will be allocated on the heap.
+	 *
+	 * \param counts The number of buffers of each class, smallest class first.
+	 */
+	explicit SlabPool(const Index (&counts)[classes])
+	{
+		for (size_t c = 0; c < classes; c++)
+		{
+			_count[c] = counts[c];
+			_data[c] = new Block[static_cast<size_t>(counts[c]) << c];
+			_available[c] = new FreeListType(counts[c]);
+		}
+	}
+
+	SlabPool(const SlabPool&) = delete;
+	SlabPool& operator=(const SlabPool&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Deallocates the buffers from the heap.
+	 */
+	~SlabPool()
+	{
+		for (size_t c = 0; c < classes; c++)
+		{
+			delete _available[c];
+			delete[] _data[c];
+		}
+	}
+
+	/**
+	 * \brief The size of the buffers of a class in bytes.
+	 */
+	static constexpr size_t classSize(size_t sizeClass)
+	{
+		return smallestSize << sizeClass;
+	}
+
+	/**
+	 * \brief The smallest class that fits the given size.
+	 *
+	 * \return The class, classes if the size exceeds the largest class.
+	 */
+	static size_t sizeClass(size_t size)
+	{
+		size_t c = 0;
+
+		while ((c < classes) && (classSize(c) < size))
+		{
+			c++;
+		}
+
+		return c;
+	}
+
+	/**
+	 * \brief Is a buffer of the given size available in the pool?
+	 */
+	bool haveAvailable(size_t size) const
+	{
+		bool available = false;
+
+		for (size_t c = sizeClass(size); !available && (c < classes); c++)
+		{
+			available = !_available[c]->isEmpty();
+		}
+
+		return available;
+	}
+
+	/**
+	 * \brief Take a buffer from the pool.
+	 *
+	 * When a buffer is taken from the pool, the new "owner" is responsible
+	 * to release it back into the pool when it is no longer needed.
+	 *
+	 * \param size The number of bytes needed.
+	 * \return Pointer to a buffer of at least size bytes (see capacity()).
+	 * 		nullptr if no buffer that fits was available.
+	 */
+	void* take(size_t size)
+	{
+		void* buffer = nullptr;
+
+		for (size_t c = sizeClass(size); (buffer == nullptr) && (c < classes); c++)
+		{
+			Index index;
+
+			if (_available[c]->pop(index))
+			{
+				buffer = &_data[c][static_cast<size_t>(index) << c];
+			}
+		}
+
+		return buffer;
+	}
+
+	/**
+	 * \brief Release a buffer into the pool.
+	 *
+	 * \param buffer The buffer to be released into the pool.
+	 * \return The buffer was successfully put in the pool.
+	 * 		When not successful the take-release mechanism was violated.
+	 */
+	bool release(void* buffer)
+	{
+		const size_t c = find(buffer);
+
+		return (c < classes) && _available[c]->push(
+				static_cast<Index>(static_cast<size_t>(static_cast<Block*>(buffer) - _data[c]) >> c));
+	}
+
+	/**
+	 * \brief The size in bytes of a buffer of this pool, 0 if it is not part of this pool.
+	 */
+	size_t capacity(const void* buffer) const
+	{
+		const size_t c = find(buffer);
+
+		return (c < classes) ? classSize(c) : 0;
+	}
+
+	/**
+	 * \brief Is the buffer part of this pool?
+	 */
+	bool contains(const void* buffer) const
+	{
+		return find(buffer) < classes;
+	}
+
+private:
+	// A unit of smallestSize bytes, buffers of class c span 1 << c of them.
+	typedef typename std::aligned_storage<smallestSize,
+			(smallestSize < alignof(std::max_align_t)) ? smallestSize : alignof(std::max_align_t)>::type Block;
+
+	Index _count[classes];
+	Block* _data[classes];
+	FreeListType* _available[classes];
+
+	/**
+	 * \brief The class the buffer belongs to, classes if it is not part of this pool.
+	 */
+	size_t find(const void* buffer) const
+	{
+		const Block* block = static_cast<const Block*>(buffer);
+
+		for (size_t c = 0; c < classes; c++)
+		{
+			const Block* first = _data[c];
+
+			if ((block >= first) && (block < first + (static_cast<size_t>(_count[c]) << c))
+					&& ((static_cast<size_t>(block - first) & ((static_cast<size_t>(1) << c) - 1)) == 0))
+			{
+				return c;
+			}
+		}
+
+		return classes;
+	}
+};
+
+/**
+ * \brief A cache in front of a pool, to be used by one thread only: a magazine.
+ *
+ * Each thread sharing a pool takes and releases through its own cache.
+ * The cache is a small local stack of elements, take() and release() only touch it
+ * and no shared cache line. Only when the magazine runs empty it is refilled from the pool,
+ * when it runs full it is flushed to the pool, half a magazine at a time in one batch.
+ * Elements can be released to any cache, also by another thread than the one that took them.
+ *
+ * The pool is the shared depot, it needs a LIFO free-list (LifoFreeList or StaticLifoFreeList)
+ * so it can be accessed by all threads. The cache returns its elements to the pool when it is destroyed.
+ *
+ * \tparam PoolType The pool, a Pool or StaticPool with a LIFO free-list.
+ * \tparam magazineSize The number of elements the cache holds at most.
+ */
+template<typename PoolType, size_t magazineSize = 16>
+class PoolCache
+{
+	typedef typename PoolType::Element DataType;
+	typedef typename PoolType::FreeList FreeListType;
+
+	static_assert(magazineSize >= 2, "A magazine holds at least two elements.");
+	static_assert(std::is_base_of<LifoFreeListBase<typename FreeListType::Index, FreeListType>, FreeListType>::value,
+			"The pool has to be shared by all threads, it needs a LIFO free-list.");
+
+public:
+	/**
+	 * \brief Create an empty cache in front of a pool.
+	 *
+	 * \param pool The pool, it has to outlive the cache.
+	 */
+	explicit PoolCache(PoolType& pool) :
+			_pool(pool),
+			_count(0)
+	{
+	}
+
+	PoolCache(const PoolCache&) = delete;
+	PoolCache& operator=(const PoolCache&) = delete;
+
+	/**
+	 * \brief Destructor, returns the cached elements to the pool.
+	 */
+	~PoolCache()
+	{
+		flush();
+	}
+
+	/**
+	 * \brief Take an element, refilling the magazine from the pool when it is empty.
+	 *
+	 * \return Pointer to an element.
+	 * 		nullptr if neither the cache nor the pool had one available.
+	 */
+	DataType* take()
+	{
+		if (_count == 0)
+		{
+			_count = _pool.take(_magazine, magazineSize / 2);
+		}
+
+		return (_count > 0) ? _magazine[--_count] : nullptr;
+	}
+
+	/**
+	 * \brief Release an element, flushing half the magazine to the pool when it is full.
+	 *
+	 * \param element The element to be released.
+	 * \return The element was successfully released.
+	 * 		When not successful the element is not part of the pool.
+	 */
+	bool release(DataType& element)
+	{
+		const bool owned = _pool.contains(element);
+
+		if (owned)
+		{
+			if (_count == magazineSize)
+			{
+				// Keep the most recently released (warm) elements, flush the oldest.
+				_pool.release(_magazine, magazineSize / 2);
+
+				for (size_t i = magazineSize / 2; i < magazineSize; i++)
+				{
+					_magazine[i - magazineSize / 2] = _magazine[i];
+				}
+
+				_count -= magazineSize / 2;
+			}
+
+			_magazine[_count++] = &element;
+		}
+
+		return owned;
+	}
+
+	/**
+	 * \brief Return all cached elements to the pool.
+	 */
+	void flush()
+	{
+		_pool.release(_magazine, _count);
+		_count = 0;
+	}
+
+	/**
+	 * \brief The number of elements in the cache.
+	 */
+	size_t cached() const
+	{
+		return _count;
+	}
+
+private:
+	PoolType& _pool;
+	DataType* _magazine[magazineSize];
+	size_t _count;
+};
+
+template<typename DataType>
+class PoolPtr;
+
+template<typename DataType>
+struct PooledElement;
+
+/**
+ * \brief Where a PooledElement returns to when its last PoolPtr is dropped.
+ */
+template<typename DataType>
+class Recycler
+{
+public:
+	/**
+	 * \brief Take back an element that is no longer referenced.
+	 */
+	virtual void recycle(PooledElement<DataType>& element) = 0;
+
+protected:
+	~Recycler() = default;
+};
+
+/**
+ * \brief An element of a SharedPool, with its reference count and its pool (intrusive).
+ */
+template<typename DataType>
+struct PooledElement
+{
+	DataType element;
+	std::atomic<uint32_t> references;
+	Recycler<DataType>* pool;
+
+	PooledElement() :
+			element(),
+			references(0),
+			pool(nullptr)
+	{
+	}
+
+	PooledElement(const PooledElement& other) :
+			element(other.element),
+			references(0),
+			pool(nullptr)
+	{
+	}
+
+	PooledElement& operator=(const PooledElement& other)
+	{
+		element = other.element;
+		return *this;
+	}
+};
+
+/**
+ * \brief A reference counted handle to an element of a SharedPool.
+ *
+ * A handle is one pointer, cheap to send through a connection:
+ * copying it increments the reference count of the element, dropping it decrements it.
+ * The element returns to its pool when the last handle is dropped,
+ * so a Split component fans a buffer out without copying it and the buffer can not leak.
+ *
+ * The reference count is atomic, handles to the same element can be copied and dropped
+ * concurrently. The element itself is shared: holders only read it,
+ * unless it is known they are the only one (see unique()).
+ *
+ * \tparam DataType The type of the element.
+ */
+template<typename DataType>
+class PoolPtr
+{
+public:
+	/**
+	 * \brief Create an empty handle.
+	 */
+	PoolPtr() :
+			_pooled(nullptr)
+	{
+	}
+
+	/**
+	 * \brief Copy constructor, one more reference to the element.
+	 */
+	PoolPtr(const PoolPtr& other) :
+			_pooled(other._pooled)
+	{
+		if (_pooled != nullptr)
+		{
+			_pooled->references.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * \brief Move constructor, the reference is taken over from the other handle.
+	 */
+	PoolPtr(PoolPtr&& other) noexcept :
+			_pooled(other._pooled)
+	{
+		other._pooled = nullptr;
+	}
+
+	/**
+	 * \brief Destructor, drops the reference.
+	 */
+	~PoolPtr()
+	{
+		reset();
+	}
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	PoolPtr& operator=(const PoolPtr& other)
+	{
+		PoolPtr copy(other);
+		std::swap(_pooled, copy._pooled);
+		return *this;
+	}
+
+	/**
+	 * \brief Move operator.
+	 */
+	PoolPtr& operator=(PoolPtr&& other) noexcept
+	{
+		// Moved out first, so a self-move keeps the reference.
+		PoolPtr moved(std::move(other));
+		std::swap(_pooled, moved._pooled);
+		return *this;
+	}
+
+	/**
+	 * \brief Drop the reference, the handle becomes empty.
+	 *
+	 * When it was the last reference the element returns to its pool.
+	 */
+	void reset()
+	{
+		if ((_pooled != nullptr)
+				&& (_pooled->references.fetch_sub(1, std::memory_order_acq_rel) == 1))
+		{
+			_pooled->pool->recycle(*_pooled);
+		}
+
+		_pooled = nullptr;
+	}
+
+	/**
+	 * \brief The element, nullptr if the handle is empty.
+	 */
+	DataType* get() const
+	{
+		return (_pooled != nullptr) ? &_pooled->element : nullptr;
+	}
+
+	DataType& operator*() const
+	{
+		return _pooled->element;
+	}
+
+	DataType* operator->() const
+	{
+		return &_pooled->element;
+	}
+
+	/**
+	 * \brief Does the handle refer to an element?
+	 */
+	explicit operator bool() const
+	{
+		return _pooled != nullptr;
+	}
+
+	/**
+	 * \brief Is this the only handle to the element?
+	 */
+	bool unique() const
+	{
+		return (_pooled != nullptr) && (_pooled->references.load(std::memory_order_acquire) == 1);
+	}
+
+	bool operator==(const PoolPtr& other) const
+	{
+		return _pooled == other._pooled;
+	}
+
+	bool operator!=(const PoolPtr& other) const
+	{
+		return _pooled != other._pooled;
+	}
+
+private:
+	PooledElement<DataType>* _pooled;
+
+	explicit PoolPtr(PooledElement<DataType>* pooled) :
+			_pooled(pooled)
+	{
+	}
+
+	template<typename, typename>
+	friend class SharedPool;
+};
+
+/**
+ * \brief A pool of DataType elements handed out as reference counted handles.
+ *
+ * Unlike Pool, elements are not released by hand: an element returns to the pool
+ * when the last PoolPtr to it is dropped, whichever component that is.
+ * Each element carries its reference count and a pointer to its pool.
+ *
+ * The pool has to outlive all handles to its elements.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam FreeListType The free-list, FifoFreeList or LifoFreeList.
+ * 		Handles are dropped by any component, LifoFreeList allows that from any thread.
+ */
+template<typename DataType, typename FreeListType = LifoFreeList<uint16_t>>
+class SharedPool :
+		private Recycler<DataType>
+{
+public:
+	/**
+	 * \brief Create a shared pool.
+	 *
+	 * \param size The size of the pool in number of DataType.
+	 */
+	explicit SharedPool(typename FreeListType::Index size) :
+			_pool(size)
+	{
+	}
+
+	SharedPool(const SharedPool&) = delete;
+	SharedPool& operator=(const SharedPool&) = delete;
+
+	/**
+	 * \brief Is an element available in the pool?
+	 */
+	bool haveAvailable() const
+	{
+		return _pool.haveAvailable();
+	}
+
+	/**
+	 * \brief Take an element from the pool.
+	 *
+	 * \return The only handle to the element.
+	 * 		An empty handle if no element was available.
+	 */
+	PoolPtr<DataType> take()
+	{
+		PooledElement<DataType>* pooled = _pool.take();
+
+		if (pooled != nullptr)
+		{
+			pooled->references.store(1, std::memory_order_relaxed);
+			pooled->pool = this;
+		}
+
+		return PoolPtr<DataType>(pooled);
+	}
+
+private:
+	Pool<PooledElement<DataType>, FreeListType> _pool;
+
+	void recycle(PooledElement<DataType>& pooled) final override
 	{
-		return _available.enqueue(&element);
+		_pool.release(pooled);
 	}
 };
 
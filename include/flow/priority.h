@@ -0,0 +1,378 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+
+#ifndef FLOW_PRIORITY_H_
+#define FLOW_PRIORITY_H_
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "flow.h"
+
+namespace Flow
+{
+
+/**
+ * \brief A connection of some type between component ports, delivering the most urgent element first.
+ *
+ * The elements are kept in a binary heap on contiguous storage, ordered by the key
+ * the KeyExtractor returns for them: the element with the highest key is received first.
+ * Elements with equal keys are received in the order they were sent, so routine traffic
+ * stays in order while an urgent element overtakes it.
+ *
+ * Sending and receiving take O(log n) moves of elements, n being the number
+ * of buffered elements. peek() and full() take O(1).
+ *
+ * Unlike the other connections a heap can not be shared without mutual exclusion.
+ * Sender and receiver take turns through a try-lock that never blocks: when the other side
+ * holds it, send() or receive() fails as if the connection was full or empty,
+ * and can simply be retried. Nobody ever waits on a lock, so the sender
+ * can still be an interrupt (it may then fail and has to retry later).
+ * peek() and full() do not take the lock.
+ *
+ * \note Recommendation: use Flow::connect() with a key extractor instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * \tparam KeyExtractor Callable returning the key of an element,
+ * 		keys are compared by operator<.
+ * \tparam IndexType The unsigned type of the number of elements, it limits the size.
+ */
+template<typename Type, typename KeyExtractor, typename IndexType = uint16_t>
+class ConnectionPriority :
+		public ConnectionOfType<Type>
+{
+public:
+	/**
+	 * \brief Create a priority connection between an output and input port.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param receiver The input port to be connected.
+	 * \param size The amount of elements the connection can buffer.
+	 * \param key The key extractor.
+	 */
+	ConnectionPriority(OutPort<Type>& sender, InPort<Type>& receiver, IndexType size,
+			KeyExtractor key = KeyExtractor()) :
+			_key(key),
+			_size(size),
+			_data(new Slot[size]),
+			_count(0),
+			_sequence(0),
+			_locked(false),
+			sender(sender),
+			receiver(receiver)
+	{
+		assert(size > 0);
+
+		sender.connect(this);
+		receiver.connect(this);
+	}
+
+	ConnectionPriority(const ConnectionPriority&) = delete;
+	ConnectionPriority& operator=(const ConnectionPriority&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the elements that were not received.
+	 */
+	virtual ~ConnectionPriority()
+	{
+		sender.disconnect();
+		receiver.disconnect();
+
+		const IndexType count = _count.load(std::memory_order_relaxed);
+
+		for (IndexType index = 0; index < count; index++)
+		{
+			at(index).~Entry();
+		}
+
+		delete[] _data;
+	}
+
+	/**
+	 * \brief Send an element over the connection.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 * 		False if the connection is full or the receiver held the lock.
+	 */
+	bool send(const Type& element) final override
+	{
+		return CopyIn<Type>::send(*this, element);
+	}
+
+	/**
+	 * \brief Send an element over the connection by moving it.
+	 *
+	 * The element is only moved from when it was sent.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 * 		False if the connection is full or the receiver held the lock.
+	 */
+	bool send(Type&& element) final override
+	{
+		return push(std::move(element));
+	}
+
+	/**
+	 * \brief Receive the element with the highest key.
+	 *
+	 * Can be called concurrently with respect to send().
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 * 		False if the connection is empty or the sender held the lock.
+	 */
+	bool receive(Type& element) final override
+	{
+		bool success = false;
+
+		if (!isEmpty() && lock())
+		{
+			IndexType count = _count.load(std::memory_order_relaxed);
+
+			if (count > 0)
+			{
+				element = std::move(at(0).element);
+				at(0).~Entry();
+
+				count--;
+
+				if (count > 0)
+				{
+					Entry last(std::move(at(count)));
+					at(count).~Entry();
+
+					siftDown(std::move(last), count);
+				}
+
+				_count.store(count, std::memory_order_relaxed);
+
+				success = true;
+			}
+
+			unlock();
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Is an element available for receiving?
+	 */
+	bool peek() const final override
+	{
+		return !isEmpty();
+	}
+
+	/**
+	 * \brief Is the connection full?
+	 */
+	bool full() const final override
+	{
+		return _count.load(std::memory_order_relaxed) == _size;
+	}
+
+private:
+	struct Entry
+	{
+		Type element;
+
+		// Orders elements with equal keys by arrival.
+		uint64_t sequence;
+
+		template<typename Element>
+		Entry(Element&& element, uint64_t sequence) :
+				element(std::forward<Element>(element)),
+				sequence(sequence)
+		{
+		}
+	};
+
+	typedef typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type Slot;
+
+	KeyExtractor _key;
+
+	const IndexType _size;
+	Slot* _data;
+
+	std::atomic<IndexType> _count;
+
+	// Only accessed with the lock held.
+	uint64_t _sequence;
+
+	std::atomic<bool> _locked;
+
+	OutPort<Type>& sender;
+	InPort<Type>& receiver;
+
+	Entry& at(size_t index)
+	{
+		return reinterpret_cast<Entry&>(_data[index]);
+	}
+
+	bool isEmpty() const
+	{
+		return _count.load(std::memory_order_relaxed) == 0;
+	}
+
+	bool lock()
+	{
+		return !_locked.exchange(true, std::memory_order_acquire);
+	}
+
+	void unlock()
+	{
+		_locked.store(false, std::memory_order_release);
+	}
+
+	/**
+	 * \brief Should entry a be received before entry b?
+	 */
+	bool before(const Entry& a, const Entry& b)
+	{
+		const bool lower = _key(a.element) < _key(b.element);
+		const bool higher = _key(b.element) < _key(a.element);
+
+		return higher || (!lower && (a.sequence < b.sequence));
+	}
+
+	template<typename Element>
+	bool push(Element&& element)
+	{
+		bool success = false;
+
+		if (!full() && lock())
+		{
+			const IndexType count = _count.load(std::memory_order_relaxed);
+
+			if (count < _size)
+			{
+				siftUp(Entry(std::forward<Element>(element), _sequence++), count);
+				_count.store(static_cast<IndexType>(count + 1), std::memory_order_relaxed);
+
+				success = true;
+			}
+
+			unlock();
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Move the parents of the entry down until its place is found, starting at the hole.
+	 */
+	void siftUp(Entry&& entry, IndexType hole)
+	{
+		while (hole > 0)
+		{
+			const IndexType parent = static_cast<IndexType>((hole - 1) / 2);
+
+			if (!before(entry, at(parent)))
+			{
+				break;
+			}
+
+			new (&at(hole)) Entry(std::move(at(parent)));
+			at(parent).~Entry();
+
+			hole = parent;
+		}
+
+		new (&at(hole)) Entry(std::move(entry));
+	}
+
+	/**
+	 * \brief Move the children of the entry up until its place is found, starting at the root.
+	 */
+	void siftDown(Entry&& entry, IndexType count)
+	{
+		size_t hole = 0;
+		size_t child = 1;
+
+		while (child < count)
+		{
+			if ((child + 1 < count) && before(at(child + 1), at(child)))
+			{
+				child++;
+			}
+
+			if (!before(at(child), entry))
+			{
+				break;
+			}
+
+			new (&at(hole)) Entry(std::move(at(child)));
+			at(child).~Entry();
+
+			hole = child;
+			child = 2 * hole + 1;
+		}
+
+		new (&at(hole)) Entry(std::move(entry));
+	}
+
+	friend struct CopyIn<Type>;
+
+	bool copyIn(const Type& element)
+	{
+		return push(element);
+	}
+};
+
+/**
+ * \brief Connect an output port to an input port, delivering the element with the highest key first.
+ *
+ * \tparam IndexType The unsigned type of the number of elements, it limits the size.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ * \param size The amount of elements the connection can buffer.
+ * \param key Callable returning the key of an element, for example a lambda.
+ */
+template<typename IndexType = uint16_t, typename Type, typename KeyExtractor>
+Connection* connect(OutPort<Type>& sender, InPort<Type>& receiver, size_t size,
+		KeyExtractor key)
+{
+	assert(size <= std::numeric_limits<IndexType>::max());
+
+	return new ConnectionPriority<Type, KeyExtractor, IndexType>(sender, receiver,
+			static_cast<IndexType>(size), key);
+}
+
+} // namespace Flow
+
+#endif /* FLOW_PRIORITY_H_ */
@@ -24,9 +24,19 @@
 #ifndef FLOW_QUEUE_H_
 #define FLOW_QUEUE_H_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <new>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <type_traits>
 #include <utility>
 
+#include "utility.h"
+
 /**
  * \brief Flow is a pipes and filters implementation tailored for (but not exclusive to) microcontrollers.
  */
@@ -34,108 +44,341 @@ namespace Flow
 {
 
 /**
- * \brief Implementation of a queue or FIFO.
+ * \brief The smallest unsigned integer type that can hold the given value.
+ */
+template<uint64_t value>
+struct SmallestIndex
+{
+	typedef typename std::conditional<(value <= UINT8_MAX), uint8_t,
+			typename std::conditional<(value <= UINT16_MAX), uint16_t,
+			typename std::conditional<(value <= UINT32_MAX), uint32_t, uint64_t>::type>::type>::type type;
+};
+
+/**
+ * \brief A contiguous region of elements.
+ */
+template<typename ElementType>
+struct Span
+{
+	ElementType* data = nullptr;
+	size_t size = 0;
+};
+
+/**
+ * \brief The elements of a queue as (at most) two contiguous regions.
  *
- * A queue is thread safe in the sense that the enqueue() and dequeue() can be called concurrently.
+ * The second region is only used when the elements wrap around
+ * the end of the storage of the queue, it then starts at the beginning of the storage.
  */
-template<typename DataType>
-class Queue
+template<typename ElementType>
+struct Spans
 {
-private:
-	DataType* _data;
-	uint16_t _size;
-	volatile uint16_t _first;
-	volatile uint16_t _last;
-	volatile uint16_t _enqueued;
-	volatile uint16_t _dequeued;
+	Span<ElementType> first;
+	Span<ElementType> second;
+
+	/**
+	 * \brief The total number of elements in both regions.
+	 */
+	size_t size() const
+	{
+		return first.size + second.size;
+	}
+};
+
+/**
+ * \brief Instrumentation policy of a queue that records nothing, the default.
+ *
+ * The hooks are never called, a queue without instrumentation has no overhead at all.
+ */
+class NoInstrumentation
+{
+public:
+	static constexpr bool enabled = false;
+
+protected:
+	template<typename IndexType>
+	void onEnqueued(IndexType /* occupancy */)
+	{
+	}
+
+	void onRejected()
+	{
+	}
+};
 
+/**
+ * \brief Instrumentation policy of a queue that records its occupancy.
+ *
+ * Helps to size a connection: it records the high-watermark, a histogram of the occupancy,
+ * how many enqueue attempts were rejected because the queue was full and how long it was full.
+ *
+ * Everything is recorded by the producer, the consumer side of the queue is not slowed down.
+ * Hence the time full is as observed by the producer: from the first rejected attempt
+ * up to the next successful one.
+ * The statistics can be read from any thread.
+ *
+ * \tparam IndexType The index type of the queue.
+ * \tparam Clock The clock measuring the time full, like the std::chrono clocks.
+ * 		On microcontrollers provide a clock with a lock free representation (e.g. a 32 bit tick counter).
+ */
+template<typename IndexType, typename Clock = std::chrono::steady_clock>
+class OccupancyStatistics
+{
 public:
+	static constexpr bool enabled = true;
+
 	/**
-	 * \brief Create a queue.
-	 *
-	 * The array of DataType will be allocated on the heap.
+	 * \brief The number of buckets of the histogram.
+	 */
+	static constexpr unsigned int buckets = sizeof(IndexType) * 8;
+
+	/**
+	 * \brief The highest number of elements the queue has held.
+	 */
+	IndexType highWatermark() const
+	{
+		return _highWatermark.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief The histogram of the occupancy, sampled after each successful enqueue.
 	 *
-	 * \param size The size of the queue in number of DataType.
+	 * \param bucket Bucket b counts the occupancies from 2^b up to 2^(b + 1) - 1.
+	 * \return The number of samples in the bucket.
 	 */
-	explicit Queue(uint16_t size) :
-			_size(size),
-			_first(0),
-			_last(0),
-			_enqueued(0),
-			_dequeued(0)
+	uint32_t histogram(unsigned int bucket) const
 	{
-		_data = new DataType[_size];
+		return (bucket < buckets) ? _histogram[bucket].load(std::memory_order_relaxed) : 0;
 	}
 
 	/**
-	 * \brief Copy constructor.
+	 * \brief The number of enqueue attempts rejected because the queue was full.
 	 *
-	 * Performs a complete, deep copy of the given queue.
-	 * The array of DataType will be allocated on the heap.
+	 * A bulk enqueue that did not fit completely counts as one rejected attempt.
+	 */
+	uint32_t rejectedFull() const
+	{
+		return _rejectedFull.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief The accumulated time the queue was full.
 	 *
-	 * \param other Queue to be copied.
+	 * A period that has not ended yet (by a successful enqueue) is not included.
 	 */
-	explicit Queue(const Queue<DataType>& other) :
-			_size(other._size),
-			_first(other._first),
-			_last(other._last),
-			_enqueued(other._enqueued),
-			_dequeued(other._dequeued)
+	typename Clock::duration timeFull() const
+	{
+		return typename Clock::duration(_timeFull.load(std::memory_order_relaxed));
+	}
+
+protected:
+	OccupancyStatistics() :
+			_highWatermark(0),
+			_rejectedFull(0),
+			_timeFull(0),
+			_full(false)
+	{
+		for (unsigned int bucket = 0; bucket < buckets; bucket++)
+		{
+			_histogram[bucket].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void onEnqueued(IndexType occupancy)
+	{
+		if (occupancy > _highWatermark.load(std::memory_order_relaxed))
+		{
+			_highWatermark.store(occupancy, std::memory_order_relaxed);
+		}
+
+		unsigned int bucket = 0;
+		while (occupancy >>= 1)
+		{
+			bucket++;
+		}
+		_histogram[bucket].store(_histogram[bucket].load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+
+		if (_full)
+		{
+			_full = false;
+			_timeFull.store(_timeFull.load(std::memory_order_relaxed)
+					+ (Clock::now() - _fullSince).count(), std::memory_order_relaxed);
+		}
+	}
+
+	void onRejected()
 	{
-		_data = new DataType[_size];
+		_rejectedFull.store(_rejectedFull.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
 
-		for(uint_fast16_t i = 0; i < _size; i++)
+		if (!_full)
 		{
-			_data[i] = other._data[i];
+			_full = true;
+			_fullSince = Clock::now();
 		}
 	}
 
+private:
+	// Only written by the producer, hence a load and store suffices.
+	std::atomic<IndexType> _highWatermark;
+	std::atomic<uint32_t> _histogram[buckets];
+	std::atomic<uint32_t> _rejectedFull;
+	std::atomic<typename Clock::rep> _timeFull;
+	typename Clock::time_point _fullSince;
+	bool _full;
+};
+
+/**
+ * \brief Implementation of a queue or FIFO, independent of where the elements are stored.
+ *
+ * The Derived class provides the storage, see Queue and StaticQueue.
+ * It has to implement:
+ * - IndexType capacity() const: the size of the queue in number of DataType.
+ * - DataType* storage(): the first element of the (uninitialized) storage.
+ * - IndexType next(IndexType index, IndexType count = 1) const: the index count positions
+ *   after the given index, wrapped around (count does not exceed the capacity).
+ *
+ * IndexType is the unsigned type of the indices and counters, it limits the capacity
+ * to its maximum value. The default uint16_t suits microcontrollers,
+ * uint32_t or uint64_t lift the limit on hosts (as long as std::atomic<IndexType> is lock free).
+ *
+ * The storage is not initialized up front: an element is constructed in place
+ * when it is enqueued and destroyed when it is dequeued.
+ * Creating a queue costs the same for any capacity and resources held
+ * by an element are freed as soon as it is consumed.
+ *
+ * A queue is thread safe in the sense that the enqueue() and dequeue() can be called concurrently,
+ * it is a single producer, single consumer (SPSC) queue.
+ * The producer publishes an element by a release store of the enqueued counter,
+ * the consumer acquires it (and vice versa for the dequeued counter).
+ * This is sufficient on multicore systems as well.
+ *
+ * The fields owned by the producer and those owned by the consumer each start
+ * on a cache line of their own (FLOW_CACHE_ALIGNED), so the cores do not false-share a cache line.
+ * Each side keeps a cached copy of the counter of the other side and only
+ * reloads it when the cached value says the queue is full (producer) or empty (consumer).
+ * Under load the cache line of the other side is transferred once per batch
+ * instead of once per element.
+ *
+ * The InstrumentationType is a policy the queue derives from, see NoInstrumentation
+ * and OccupancyStatistics. The producer side reports each enqueue attempt to it.
+ */
+template<typename DataType, typename IndexType, typename InstrumentationType, typename Derived>
+class QueueBase :
+		public InstrumentationType
+{
+	static_assert(std::is_unsigned<IndexType>::value, "The index type must be an unsigned integer type.");
+
+public:
+	/**
+	 * \brief The type of the indices and counters, the capacity and numbers of elements.
+	 */
+	typedef IndexType Index;
+
 	/**
-	 * \brief Assignment operator.
+	 * \brief The instrumentation policy of the queue.
 	 */
-	Queue& operator=(const Queue<DataType>& other)
+	typedef InstrumentationType Instrumentation;
+
+protected:
+	// Owned by the producer, see enqueue().
+	FLOW_CACHE_ALIGNED IndexType _last;
+	IndexType _dequeuedCache;
+	std::atomic<IndexType> _enqueued;
+
+	// Owned by the consumer, see dequeue().
+	FLOW_CACHE_ALIGNED IndexType _first;
+	mutable IndexType _enqueuedCache;
+	std::atomic<IndexType> _dequeued;
+
+	QueueBase() :
+			_last(0),
+			_dequeuedCache(0),
+			_enqueued(0),
+			_first(0),
+			_enqueuedCache(0),
+			_dequeued(0)
+	{
+	}
+
+	QueueBase(const QueueBase& other) :
+			_last(other._last),
+			_dequeuedCache(other._dequeuedCache),
+			_enqueued(other._enqueued.load()),
+			_first(other._first),
+			_enqueuedCache(other._enqueuedCache),
+			_dequeued(other._dequeued.load())
 	{
-		Queue<DataType> shadow(other);
-		*this = std::move(shadow);
-		return *this;
 	}
 
 	/**
-	 * \brief Move operator.
+	 * \brief Copy construct the elements of the other queue in this queue.
+	 *
+	 * The indices have to be copied first, all elements of this queue have to be destroyed.
 	 */
-	Queue& operator=(Queue<DataType>&& other) noexcept
+	void copyElements(const Derived& other)
 	{
-		if(this != &other)
+		IndexType index = _first;
+
+		for (IndexType i = 0; i < elements(); i++)
 		{
-			delete[] _data;
-			_data = other._data;
-			other._data = nullptr;
-			_size = other._size;
-			_first = other._first;
-			_last = other._last;
-			_enqueued = other._enqueued;
-			_dequeued = other._dequeued;
+			new (&derived().storage()[index]) DataType(other.storage()[index]);
+			index = derived().next(index);
 		}
+	}
 
-		return *this;
+	/**
+	 * \brief Destroy all elements in the queue, leaving it empty.
+	 */
+	void destroyElements()
+	{
+		const IndexType count = elements();
+
+		for (IndexType i = 0; i < count; i++)
+		{
+			derived().storage()[_first].~DataType();
+			_first = derived().next(_first);
+		}
+
+		reset();
 	}
 
 	/**
-	 * \brief Destructor.
+	 * \brief Make the queue empty, without destroying any element.
 	 *
-	 * Deallocates the array of DataType from the heap.
+	 * Only to be used when the storage was handed over to another queue.
 	 */
-	~Queue()
+	void reset()
 	{
-		delete[] _data;
+		_last = 0;
+		_dequeuedCache = 0;
+		_enqueued.store(0);
+		_first = 0;
+		_enqueuedCache = 0;
+		_dequeued.store(0);
+	}
+
+	QueueBase& operator=(const QueueBase& other)
+	{
+		_last = other._last;
+		_dequeuedCache = other._dequeuedCache;
+		_enqueued.store(other._enqueued.load());
+		_first = other._first;
+		_enqueuedCache = other._enqueuedCache;
+		_dequeued.store(other._dequeued.load());
+
+		return *this;
 	}
 
+public:
 	/**
 	 * \brief Is the queue empty?
 	 */
 	bool isEmpty() const
 	{
-		return (_enqueued == _dequeued);
+		return (_enqueued.load(std::memory_order_acquire)
+				== _dequeued.load(std::memory_order_acquire));
 	}
 
 	/**
@@ -143,17 +386,18 @@ public:
 	 */
 	bool isFull() const
 	{
-		return (_enqueued == static_cast<uint16_t>(_dequeued + _size));
+		return (_enqueued.load(std::memory_order_acquire)
+				== static_cast<IndexType>(_dequeued.load(std::memory_order_acquire)
+						+ derived().capacity()));
 	}
 
 	/**
 	 * \brief The number of elements in the queue.
 	 */
-	uint16_t elements() const
+	IndexType elements() const
 	{
-		int32_t delta = static_cast<int32_t>(_enqueued) - static_cast<int32_t>(_dequeued);
-
-		return static_cast<uint16_t>((delta >= 0) ? delta : delta + UINT16_MAX + 1);
+		return static_cast<IndexType>(_enqueued.load(std::memory_order_acquire)
+				- _dequeued.load(std::memory_order_acquire));
 	}
 
 	/**
@@ -169,16 +413,92 @@ public:
 	{
 		bool success = false;
 
-		if (!isFull())
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed);
+
+		if (room(enqueued, 1) > 0)
+		{
+			new (&derived().storage()[_last]) DataType(element);
+
+			_last = derived().next(_last);
+
+			_enqueued.store(enqueued + 1, std::memory_order_release);
+			instrumentEnqueued(enqueued + 1);
+
+			success = true;
+		}
+		else
+		{
+			instrumentRejected();
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType by moving it into the queue.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * If the queue is full the given element is not added (nor moved from).
+	 *
+	 * \param element The element to be enqueued.
+	 * \return The element was successfully enqueued.
+	 */
+	bool enqueue(DataType&& element)
+	{
+		bool success = false;
+
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed);
+
+		if (room(enqueued, 1) > 0)
+		{
+			new (&derived().storage()[_last]) DataType(std::move(element));
+
+			_last = derived().next(_last);
+
+			_enqueued.store(enqueued + 1, std::memory_order_release);
+			instrumentEnqueued(enqueued + 1);
+
+			success = true;
+		}
+		else
+		{
+			instrumentRejected();
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Enqueue an element of DataType constructed from the given arguments.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * If the queue is full no element is constructed.
+	 *
+	 * \param arguments The arguments for the constructor of DataType.
+	 * \return The element was successfully enqueued.
+	 */
+	template<typename... Arguments>
+	bool emplace(Arguments&&... arguments)
+	{
+		bool success = false;
+
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed);
+
+		if (room(enqueued, 1) > 0)
 		{
-			_data[_last] = element;
+			new (&derived().storage()[_last]) DataType(std::forward<Arguments>(arguments)...);
 
-			_last = (_last == _size - 1) ? 0 : _last + 1;
+			_last = derived().next(_last);
 
-			_enqueued++;
+			_enqueued.store(enqueued + 1, std::memory_order_release);
+			instrumentEnqueued(enqueued + 1);
 
 			success = true;
 		}
+		else
+		{
+			instrumentRejected();
+		}
 
 		return success;
 	}
@@ -187,6 +507,7 @@ public:
 	 * \brief Dequeue an element of DataType.
 	 *
 	 * Can be called concurrently with respect to enqueue().
+	 * The element is moved out of the queue.
 	 *
 	 * \param element [output] The dequeued element.
 	 * 		The return value indicates whether the element is valid.
@@ -197,13 +518,17 @@ public:
 	{
 		bool success = false;
 
-		if (!isEmpty())
+		const IndexType dequeued = _dequeued.load(std::memory_order_relaxed);
+
+		if (available(dequeued, 1) > 0)
 		{
-			element = _data[_first];
+			DataType& first = derived().storage()[_first];
+			element = std::move(first);
+			first.~DataType();
 
-			_first = (_first == _size - 1) ? 0 : _first + 1;
+			_first = derived().next(_first);
 
-			_dequeued++;
+			_dequeued.store(dequeued + 1, std::memory_order_release);
 
 			success = true;
 		}
@@ -215,6 +540,7 @@ public:
 	 * \brief Peek in the queue.
 	 *
 	 * Does not modify the queue in any way.
+	 * Must be called from the consumer side, like dequeue().
 	 *
 	 * \param element [output] The next element to be dequeued.
 	 * 		The return value indicates whether the element is valid.
@@ -225,15 +551,611 @@ public:
 	{
 		bool success = false;
 
-		if (!isEmpty())
+		if (available(_dequeued.load(std::memory_order_relaxed), 1) > 0)
 		{
-			element = _data[_first];
+			element = derived().storage()[_first];
 
 			success = true;
 		}
 
 		return success;
 	}
+
+	/**
+	 * \brief Enqueue a number of consecutive elements of DataType.
+	 *
+	 * Can be called concurrently with respect to dequeue().
+	 * As many elements as there is room for are enqueued,
+	 * they are published to the consumer at once.
+	 * Trivially copyable elements are copied with memcpy(),
+	 * others are copy constructed in place.
+	 *
+	 * \param elements The elements to be enqueued.
+	 * \param count The number of elements to be enqueued.
+	 * \return The number of elements that was enqueued.
+	 */
+	IndexType enqueue(const DataType* elements, IndexType count)
+	{
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed);
+		const IndexType wanted = count;
+
+		count = std::min(count, room(enqueued, count));
+
+		if (count < wanted)
+		{
+			instrumentRejected();
+		}
+
+		if (count > 0)
+		{
+			const IndexType contiguous = std::min<IndexType>(count, derived().capacity() - _last);
+
+			copy(&derived().storage()[_last], elements, contiguous);
+			copy(&derived().storage()[0], elements + contiguous, count - contiguous);
+
+			_last = derived().next(_last, count);
+
+			_enqueued.store(enqueued + count, std::memory_order_release);
+			instrumentEnqueued(enqueued + count);
+		}
+
+		return count;
+	}
+
+	/**
+	 * \brief Dequeue a number of elements of DataType.
+	 *
+	 * Can be called concurrently with respect to enqueue().
+	 * As many elements as available (up to count) are dequeued,
+	 * their slots are handed back to the producer at once.
+	 * The elements are moved out of the queue and destroyed,
+	 * trivially copyable elements are copied with memcpy().
+	 *
+	 * \param elements [output] The dequeued elements.
+	 * \param count The maximum number of elements to be dequeued.
+	 * \return The number of elements that was dequeued.
+	 */
+	IndexType dequeue(DataType* elements, IndexType count)
+	{
+		const IndexType dequeued = _dequeued.load(std::memory_order_relaxed);
+
+		count = std::min(count, available(dequeued, count));
+
+		if (count > 0)
+		{
+			const IndexType contiguous = std::min<IndexType>(count, derived().capacity() - _first);
+
+			move(elements, &derived().storage()[_first], contiguous);
+			move(elements + contiguous, &derived().storage()[0], count - contiguous);
+
+			_first = derived().next(_first, count);
+
+			_dequeued.store(dequeued + count, std::memory_order_release);
+		}
+
+		return count;
+	}
+
+	/**
+	 * \brief Reserve the next element of the queue, to be filled in place.
+	 *
+	 * Can be called concurrently with respect to the consumer side.
+	 * The element is default-initialized, it is only published to the consumer by commit().
+	 *
+	 * \return The element to be filled in.
+	 * 		nullptr if the queue is full.
+	 */
+	DataType* reserve()
+	{
+		DataType* element = nullptr;
+
+		if (room(_enqueued.load(std::memory_order_relaxed), 1) > 0)
+		{
+			element = new (&derived().storage()[_last]) DataType;
+		}
+		else
+		{
+			instrumentRejected();
+		}
+
+		return element;
+	}
+
+	/**
+	 * \brief Publish the element obtained by reserve() to the consumer.
+	 *
+	 * \remark Every reserve() that returned an element must be followed by commit().
+	 */
+	void commit()
+	{
+		_last = derived().next(_last);
+
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed) + 1;
+
+		_enqueued.store(enqueued, std::memory_order_release);
+		instrumentEnqueued(enqueued);
+	}
+
+	/**
+	 * \brief Access the next element to be dequeued, in place.
+	 *
+	 * Can be called concurrently with respect to the producer side.
+	 * The element remains in the queue until pop() is called.
+	 *
+	 * \return The next element to be dequeued.
+	 * 		nullptr if the queue is empty.
+	 */
+	const DataType* front() const
+	{
+		const DataType* element = nullptr;
+
+		if (available(_dequeued.load(std::memory_order_relaxed), 1) > 0)
+		{
+			element = &derived().storage()[_first];
+		}
+
+		return element;
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the queue.
+	 *
+	 * \remark Only call this after front() returned an element.
+	 */
+	void pop()
+	{
+		derived().storage()[_first].~DataType();
+
+		_first = derived().next(_first);
+
+		_dequeued.store(_dequeued.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	 * \brief Access all elements that can be dequeued, in place.
+	 *
+	 * Can be called concurrently with respect to the producer side.
+	 * The elements remain in the queue until consume() is called.
+	 *
+	 * \return The elements in the queue, in order.
+	 */
+	Spans<const DataType> readableSpans() const
+	{
+		const IndexType count = available(_dequeued.load(std::memory_order_relaxed), derived().capacity());
+		const IndexType contiguous = std::min<IndexType>(count, derived().capacity() - _first);
+
+		Spans<const DataType> spans;
+		spans.first.data = &derived().storage()[_first];
+		spans.first.size = contiguous;
+		spans.second.data = &derived().storage()[0];
+		spans.second.size = count - contiguous;
+
+		return spans;
+	}
+
+	/**
+	 * \brief Remove a number of elements obtained by readableSpans() from the queue.
+	 *
+	 * \remark The count must not exceed the size of the spans.
+	 *
+	 * \param count The number of elements to be removed.
+	 */
+	void consume(IndexType count)
+	{
+		if (!std::is_trivially_destructible<DataType>::value)
+		{
+			IndexType index = _first;
+
+			for (IndexType i = 0; i < count; i++)
+			{
+				derived().storage()[index].~DataType();
+				index = derived().next(index);
+			}
+		}
+
+		_first = derived().next(_first, count);
+
+		_dequeued.store(_dequeued.load(std::memory_order_relaxed) + count, std::memory_order_release);
+	}
+
+	/**
+	 * \brief Access all free slots of the queue, to be filled in place.
+	 *
+	 * Can be called concurrently with respect to the consumer side.
+	 * The elements are only published to the consumer by produce().
+	 * Only available for trivial types, the slots are not initialized.
+	 *
+	 * \return The free slots of the queue, in order.
+	 */
+	Spans<DataType> writableSpans()
+	{
+		static_assert(std::is_trivial<DataType>::value, "Only trivial types can be written in place.");
+
+		const IndexType count = room(_enqueued.load(std::memory_order_relaxed), derived().capacity());
+		const IndexType contiguous = std::min<IndexType>(count, derived().capacity() - _last);
+
+		Spans<DataType> spans;
+		spans.first.data = &derived().storage()[_last];
+		spans.first.size = contiguous;
+		spans.second.data = &derived().storage()[0];
+		spans.second.size = count - contiguous;
+
+		return spans;
+	}
+
+	/**
+	 * \brief Publish a number of elements written in the spans obtained by writableSpans().
+	 *
+	 * \remark The count must not exceed the size of the spans.
+	 *
+	 * \param count The number of elements to be published.
+	 */
+	void produce(IndexType count)
+	{
+		_last = derived().next(_last, count);
+
+		const IndexType enqueued = _enqueued.load(std::memory_order_relaxed) + count;
+
+		_enqueued.store(enqueued, std::memory_order_release);
+		instrumentEnqueued(enqueued);
+	}
+
+private:
+	/**
+	 * \brief Producer side: report elements were enqueued to the instrumentation.
+	 *
+	 * Compiles to nothing when the instrumentation is disabled.
+	 *
+	 * \param enqueued The new value of the enqueued counter.
+	 */
+	void instrumentEnqueued(IndexType enqueued)
+	{
+		if (Instrumentation::enabled)
+		{
+			Instrumentation::onEnqueued(static_cast<IndexType>(enqueued
+					- _dequeued.load(std::memory_order_relaxed)));
+		}
+	}
+
+	/**
+	 * \brief Producer side: report an enqueue attempt was rejected to the instrumentation.
+	 *
+	 * Compiles to nothing when the instrumentation is disabled.
+	 */
+	void instrumentRejected()
+	{
+		if (Instrumentation::enabled)
+		{
+			Instrumentation::onRejected();
+		}
+	}
+
+	/**
+	 * \brief Producer side: how many elements is there room for?
+	 *
+	 * The cached dequeued counter is only refreshed when it says
+	 * there is less room than wanted.
+	 *
+	 * \param enqueued The current value of the enqueued counter.
+	 * \param wanted The number of elements the producer would like to enqueue.
+	 */
+	IndexType room(IndexType enqueued, IndexType wanted)
+	{
+		IndexType room = static_cast<IndexType>(derived().capacity()
+				- static_cast<IndexType>(enqueued - _dequeuedCache));
+
+		if (room < wanted)
+		{
+			_dequeuedCache = _dequeued.load(std::memory_order_acquire);
+			room = static_cast<IndexType>(derived().capacity()
+					- static_cast<IndexType>(enqueued - _dequeuedCache));
+		}
+
+		return room;
+	}
+
+	/**
+	 * \brief Consumer side: how many elements are available?
+	 *
+	 * The cached enqueued counter is only refreshed when it says
+	 * less elements are available than wanted.
+	 *
+	 * \param dequeued The current value of the dequeued counter.
+	 * \param wanted The number of elements the consumer would like to dequeue.
+	 */
+	IndexType available(IndexType dequeued, IndexType wanted) const
+	{
+		IndexType available = static_cast<IndexType>(_enqueuedCache - dequeued);
+
+		if (available < wanted)
+		{
+			_enqueuedCache = _enqueued.load(std::memory_order_acquire);
+			available = static_cast<IndexType>(_enqueuedCache - dequeued);
+		}
+
+		return available;
+	}
+
+	static void copy(DataType* destination, const DataType* source, IndexType count)
+	{
+		copy(destination, source, count, std::is_trivially_copyable<DataType>());
+	}
+
+	static void copy(DataType* destination, const DataType* source, IndexType count,
+			std::true_type /* trivially copyable */)
+	{
+		if (count > 0)
+		{
+			memcpy(destination, source, count * sizeof(DataType));
+		}
+	}
+
+	static void copy(DataType* destination, const DataType* source, IndexType count,
+			std::false_type /* trivially copyable */)
+	{
+		for (IndexType i = 0; i < count; i++)
+		{
+			new (&destination[i]) DataType(source[i]);
+		}
+	}
+
+	static void move(DataType* destination, DataType* source, IndexType count)
+	{
+		move(destination, source, count, std::is_trivially_copyable<DataType>());
+	}
+
+	static void move(DataType* destination, DataType* source, IndexType count,
+			std::true_type /* trivially copyable */)
+	{
+		copy(destination, source, count, std::true_type());
+	}
+
+	static void move(DataType* destination, DataType* source, IndexType count,
+			std::false_type /* trivially copyable */)
+	{
+		for (IndexType i = 0; i < count; i++)
+		{
+			destination[i] = std::move(source[i]);
+			source[i].~DataType();
+		}
+	}
+
+	Derived& derived()
+	{
+		return *static_cast<Derived*>(this);
+	}
+
+	const Derived& derived() const
+	{
+		return *static_cast<const Derived*>(this);
+	}
+};
+
+/**
+ * \brief Implementation of a queue or FIFO.
+ *
+ * The capacity is chosen at runtime, the array of DataType is allocated on the heap.
+ *
+ * A queue is thread safe in the sense that the enqueue() and dequeue() can be called concurrently.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters, it limits the capacity.
+ * \tparam InstrumentationType NoInstrumentation or OccupancyStatistics<IndexType>.
+ */
+template<typename DataType, typename IndexType = uint16_t,
+		typename InstrumentationType = NoInstrumentation>
+class Queue :
+		public QueueBase<DataType, IndexType, InstrumentationType,
+				Queue<DataType, IndexType, InstrumentationType>>
+{
+private:
+	typedef typename std::aligned_storage<sizeof(DataType), alignof(DataType)>::type Slot;
+
+	Slot* _data;
+	IndexType _size;
+
+	typedef QueueBase<DataType, IndexType, InstrumentationType, Queue> Base;
+
+	friend Base;
+
+public:
+	/**
+	 * \brief Create a queue.
+	 *
+	 * The (uninitialized) array of DataType will be allocated on the heap.
+	 *
+	 * \param size The size of the queue in number of DataType.
+	 */
+	explicit Queue(IndexType size) :
+			_size(size)
+	{
+		_data = new Slot[_size];
+	}
+
+	/**
+	 * \brief Copy constructor.
+	 *
+	 * Performs a complete, deep copy of the given queue.
+	 * The array of DataType will be allocated on the heap.
+	 *
+	 * \param other Queue to be copied.
+	 */
+	explicit Queue(const Queue& other) :
+			Base(other),
+			_size(other._size)
+	{
+		_data = new Slot[_size];
+
+		this->copyElements(other);
+	}
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	Queue& operator=(const Queue& other)
+	{
+		Queue shadow(other);
+		*this = std::move(shadow);
+		return *this;
+	}
+
+	/**
+	 * \brief Move operator.
+	 */
+	Queue& operator=(Queue&& other) noexcept
+	{
+		if(this != &other)
+		{
+			this->destroyElements();
+			delete[] _data;
+			_data = other._data;
+			other._data = nullptr;
+			_size = other._size;
+			Base::operator=(other);
+			other.reset();
+		}
+
+		return *this;
+	}
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the remaining elements and
+	 * deallocates the array of DataType from the heap.
+	 */
+	~Queue()
+	{
+		this->destroyElements();
+		delete[] _data;
+	}
+
+private:
+	IndexType capacity() const
+	{
+		return _size;
+	}
+
+	DataType* storage()
+	{
+		return reinterpret_cast<DataType*>(_data);
+	}
+
+	const DataType* storage() const
+	{
+		return reinterpret_cast<const DataType*>(_data);
+	}
+
+	IndexType next(IndexType index, IndexType count = 1) const
+	{
+		return (index >= _size - count) ? index - (_size - count) : index + count;
+	}
+};
+
+/**
+ * \brief Implementation of a queue or FIFO with a capacity known at compile time.
+ *
+ * The array of DataType is part of the queue itself, no heap is involved.
+ * A StaticQueue with static storage duration ends up in .bss,
+ * where the linker accounts for it.
+ *
+ * When the capacity is a power of two the indices wrap around by masking,
+ * enqueue() and dequeue() are then free of branches.
+ *
+ * A queue is thread safe in the sense that the enqueue() and dequeue() can be called concurrently.
+ *
+ * \tparam DataType The type of the elements.
+ * \tparam size The size of the queue in number of DataType.
+ * \tparam IndexType The unsigned type of the indices and counters,
+ * 		by default the smallest type that can hold the size.
+ * \tparam InstrumentationType NoInstrumentation or OccupancyStatistics<IndexType>.
+ */
+template<typename DataType, size_t size, typename IndexType = typename SmallestIndex<size>::type,
+		typename InstrumentationType = NoInstrumentation>
+class StaticQueue :
+		public QueueBase<DataType, IndexType, InstrumentationType,
+				StaticQueue<DataType, size, IndexType, InstrumentationType>>
+{
+	static_assert(size > 0, "A queue must be able to hold at least one element.");
+	static_assert(size <= std::numeric_limits<IndexType>::max(), "The index type cannot hold the size.");
+
+private:
+	typedef typename std::aligned_storage<sizeof(DataType), alignof(DataType)>::type Slot;
+
+	Slot _data[size];
+
+	typedef QueueBase<DataType, IndexType, InstrumentationType, StaticQueue> Base;
+
+	friend Base;
+
+	static constexpr bool powerOf2 = ((size & (size - 1)) == 0);
+
+public:
+	/**
+	 * \brief Create a queue.
+	 */
+	StaticQueue() = default;
+
+	/**
+	 * \brief Copy constructor.
+	 *
+	 * Copies the elements of the given queue.
+	 *
+	 * \param other Queue to be copied.
+	 */
+	StaticQueue(const StaticQueue& other) :
+			Base(other)
+	{
+		this->copyElements(other);
+	}
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	StaticQueue& operator=(const StaticQueue& other)
+	{
+		if(this != &other)
+		{
+			this->destroyElements();
+			Base::operator=(other);
+			this->copyElements(other);
+		}
+
+		return *this;
+	}
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the remaining elements.
+	 */
+	~StaticQueue()
+	{
+		this->destroyElements();
+	}
+
+private:
+	static constexpr IndexType capacity()
+	{
+		return size;
+	}
+
+	DataType* storage()
+	{
+		return reinterpret_cast<DataType*>(_data);
+	}
+
+	const DataType* storage() const
+	{
+		return reinterpret_cast<const DataType*>(_data);
+	}
+
+	static IndexType next(IndexType index, IndexType count = 1)
+	{
+		return powerOf2 ?
+				static_cast<IndexType>((index + count) & (size - 1)) :
+				static_cast<IndexType>((index >= size - count) ? index - (size - count) : index + count);
+	}
 };
 
 } // namespace Flow
@@ -0,0 +1,305 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+
+#ifndef FLOW_RECORD_H_
+#define FLOW_RECORD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "flow.h"
+#include "utility.h"
+
+namespace Flow
+{
+
+class InRecord;
+class OutRecord;
+
+/**
+ * \brief A connection of variable-length records (frames of bytes) between record ports.
+ *
+ * The sender reserves a contiguous region for a record, writes it in place and commits it,
+ * the receiver reads the record in place as one contiguous span and pops it.
+ * No byte is copied or sent on its own, there is one call per record.
+ *
+ * The buffer is a bip-buffer: a record that does not fit at the end of the buffer
+ * is started at the beginning instead of being split across the wrap.
+ * The unused tail is marked by a watermark, the receiver wraps when it reaches it.
+ * Every record is preceded by a 32 bit length and aligned to 4 bytes.
+ *
+ * Lock-free for a single sender and a single receiver.
+ */
+class ConnectionRecord :
+		public Connection
+{
+public:
+	/**
+	 * \brief Create a connection between an output and input record port.
+	 *
+	 * \param sender The output record port to be connected.
+	 * \param receiver The input record port to be connected.
+	 * \param size The size of the buffer in bytes, including 4 bytes of overhead per record.
+	 */
+	ConnectionRecord(OutRecord& sender, InRecord& receiver, size_t size);
+
+	ConnectionRecord(const ConnectionRecord&) = delete;
+	ConnectionRecord& operator=(const ConnectionRecord&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 */
+	virtual ~ConnectionRecord();
+
+	/**
+	 * \brief Reserve a contiguous region for a record, to be filled in place.
+	 *
+	 * \param size The (maximum) size of the record in bytes.
+	 * \return The region to be filled in, aligned to 4 bytes.
+	 * 		nullptr if there is not enough contiguous room.
+	 */
+	uint8_t* reserve(size_t size);
+
+	/**
+	 * \brief Send the record in the region obtained by reserve().
+	 *
+	 * \param size The actual size of the record, at most the reserved size.
+	 * 		0 discards the reservation.
+	 */
+	void commit(size_t size);
+
+	/**
+	 * \brief Send a record by copying it.
+	 *
+	 * \param data The record to be sent.
+	 * \param size The size of the record in bytes.
+	 * \return The record was successfully sent.
+	 */
+	bool send(const uint8_t* data, size_t size);
+
+	/**
+	 * \brief Access the next record to be received, in place.
+	 *
+	 * \return The record, empty if no record is available.
+	 */
+	Span<const uint8_t> front();
+
+	/**
+	 * \brief Remove the record obtained by front() from the connection.
+	 */
+	void pop();
+
+	/**
+	 * \brief Is a record available for receiving?
+	 */
+	bool peek() const;
+
+private:
+	static const size_t HEADER = sizeof(uint32_t);
+
+	OutRecord& sender;
+	InRecord& receiver;
+
+	uint32_t* const _buffer;
+	uint8_t* const _data;
+	const size_t _size;
+
+	// Written by the sender: the end of the written records and,
+	// when the sender wrapped around before the receiver did, the end of the records before the wrap.
+	std::atomic<size_t> _write;
+	std::atomic<size_t> _watermark;
+
+	// Owned by the sender.
+	size_t _reserved;
+	size_t _reservedSize;
+	bool _reserving;
+	bool _wrapping;
+
+	// Written by the receiver: the start of the next record.
+	FLOW_CACHE_ALIGNED std::atomic<size_t> _read;
+
+	static size_t footprint(size_t size);
+
+	uint32_t length(size_t position) const;
+};
+
+/**
+ * \brief An input record port of a component.
+ */
+class InRecord :
+		protected Peek
+{
+public:
+	/**
+	 * \brief Create an input record port.
+	 */
+	explicit InRecord(Component* owner);
+
+	/**
+	 * \brief Access the next record to be received, in place.
+	 *
+	 * Can be called concurrently with respect to send() of the connected output record port.
+	 * The record remains in the connection until pop() is called.
+	 *
+	 * \return The record, empty if no record is available or the port is not connected.
+	 */
+	Span<const uint8_t> front();
+
+	/**
+	 * \brief Remove the record obtained by front() from the connection.
+	 *
+	 * \remark Only call this after front() returned a record.
+	 */
+	void pop();
+
+	/**
+	 * \brief Is a record available for receiving?
+	 */
+	bool peek() const final override;
+
+	/**
+	 * \brief Associate this input record port with a connection.
+	 *
+	 * \note Recommendation: use Flow::connect() instead.
+	 *
+	 * \param connection The connection to be associated.
+	 */
+	void connect(ConnectionRecord* connection);
+
+	/**
+	 * \brief Dissociate this input record port and it's connection.
+	 *
+	 * \note Recommendation: use Flow::disconnect() instead.
+	 */
+	void disconnect();
+
+private:
+	ConnectionRecord* connection = nullptr;
+
+	/**
+	 * \brief Is this input record port associated with a connection?
+	 */
+	bool isConnected() const;
+};
+
+/**
+ * \brief An output record port of a component.
+ */
+class OutRecord
+{
+public:
+	/**
+	 * \brief Reserve a contiguous region for a record, to be filled in place.
+	 *
+	 * Can be called concurrently with respect to front() and pop() of the connected input record port.
+	 * The record is only sent by commit().
+	 *
+	 * \param size The (maximum) size of the record in bytes.
+	 * \return The region to be filled in.
+	 * 		nullptr if there is not enough contiguous room or the port is not connected.
+	 */
+	uint8_t* reserve(size_t size);
+
+	/**
+	 * \brief Send the record in the region obtained by reserve().
+	 *
+	 * \remark Only call this after reserve() returned a region.
+	 *
+	 * \param size The actual size of the record, at most the reserved size.
+	 * 		0 discards the reservation.
+	 */
+	void commit(size_t size);
+
+	/**
+	 * \brief Send a record by copying it.
+	 *
+	 * \param data The record to be sent.
+	 * \param size The size of the record in bytes.
+	 * \return The record was successfully sent.
+	 */
+	bool send(const uint8_t* data, size_t size);
+
+	/**
+	 * \brief Associate this output record port with a connection.
+	 *
+	 * \note Recommendation: use Flow::connect() instead.
+	 *
+	 * \param connection The connection to be associated.
+	 */
+	void connect(ConnectionRecord* connection);
+
+	/**
+	 * \brief Dissociate this output record port and it's connection.
+	 *
+	 * \note Recommendation: use Flow::disconnect() instead.
+	 */
+	void disconnect();
+
+private:
+	ConnectionRecord* connection = nullptr;
+
+	bool isConnected() const;
+};
+
+/**
+ * \brief Connect an output record port to an input record port.
+ *
+ * \param sender The output record port to be connected.
+ * \param receiver The input record port to be connected.
+ * \param size The size of the buffer in bytes.
+ */
+Connection* connect(OutRecord& sender, InRecord& receiver, size_t size);
+
+/**
+ * \brief Connect an output record port to an input record port.
+ *
+ * \param sender The output record port to be connected.
+ * \param receiver The input record port to be connected.
+ * \param size The size of the buffer in bytes.
+ */
+Connection* connect(OutRecord* sender, InRecord& receiver, size_t size);
+
+/**
+ * \brief Connect an output record port to an input record port.
+ *
+ * \param sender The output record port to be connected.
+ * \param receiver The input record port to be connected.
+ * \param size The size of the buffer in bytes.
+ */
+Connection* connect(OutRecord& sender, InRecord* receiver, size_t size);
+
+/**
+ * \brief Connect an output record port to an input record port.
+ *
+ * \param sender The output record port to be connected.
+ * \param receiver The input record port to be connected.
+ * \param size The size of the buffer in bytes.
+ */
+Connection* connect(OutRecord* sender, InRecord* receiver, size_t size);
+
+} // namespace Flow
+
+#endif /* FLOW_RECORD_H_ */
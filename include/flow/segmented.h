@@ -0,0 +1,458 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+
+#ifndef FLOW_SEGMENTED_H_
+#define FLOW_SEGMENTED_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "flow.h"
+#include "utility.h"
+
+namespace Flow
+{
+
+/**
+ * \brief A connection of some type between component ports, growing and shrinking with the load.
+ *
+ * The elements are buffered in a linked list of fixed-size chunks instead of one ring
+ * sized for the worst case. The sender appends a chunk when the last one is full,
+ * the receiver unlinks a chunk once it has received all of its elements.
+ *
+ * Emptied chunks are kept on a lock-free free-list for the sender to reuse,
+ * so a steady stream does not touch the heap. Only a number of spare chunks is kept,
+ * chunks beyond that are released: memory grown for a burst is returned afterwards.
+ * The free-list is a Treiber stack; only the receiver pushes and only the sender pops,
+ * with a single popper a chunk can not be removed and pushed back behind its back (no ABA).
+ *
+ * An optional ceiling bounds the number of chunks, once reached the connection is full.
+ *
+ * \note Recommendation: use Flow::connectSegmented() instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * \tparam chunkSize The number of elements per chunk.
+ */
+template<typename Type, size_t chunkSize = 64>
+class ConnectionSegmented :
+		public ConnectionOfType<Type>
+{
+	static_assert(chunkSize > 0, "A chunk holds at least one element.");
+
+public:
+	/**
+	 * \brief Create a segmented connection between an output and input port.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param receiver The input port to be connected.
+	 * \param maxChunks The maximum number of chunks, 0 is unbounded, otherwise at least 2.
+	 * \param spareChunks The number of emptied chunks kept for reuse.
+	 */
+	ConnectionSegmented(OutPort<Type>& sender, InPort<Type>& receiver,
+			size_t maxChunks = 0, size_t spareChunks = 1) :
+			_maxChunks(maxChunks),
+			_spareChunks(spareChunks),
+			_chunks(1),
+			_spares(nullptr),
+			_spareCount(0),
+			_tailWritten(0),
+			_tail(new Chunk()),
+			_written(0),
+			_head(_tail),
+			_read(0),
+			sender(sender),
+			receiver(receiver)
+	{
+		assert((maxChunks == 0) || (maxChunks >= 2));
+
+		sender.connect(this);
+		receiver.connect(this);
+	}
+
+	ConnectionSegmented(const ConnectionSegmented&) = delete;
+	ConnectionSegmented& operator=(const ConnectionSegmented&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * Destroys the elements that were not received and releases all chunks.
+	 */
+	virtual ~ConnectionSegmented()
+	{
+		sender.disconnect();
+		receiver.disconnect();
+
+		Chunk* chunk = _head;
+		size_t index = _read;
+
+		while (chunk != nullptr)
+		{
+			const size_t written = chunk->written.load(std::memory_order_acquire);
+
+			for (; index < written; index++)
+			{
+				chunk->element(index).~Type();
+			}
+
+			Chunk* next = chunk->next.load(std::memory_order_acquire);
+			delete chunk;
+
+			chunk = next;
+			index = 0;
+		}
+
+		while ((chunk = obtainSpare()) != nullptr)
+		{
+			delete chunk;
+		}
+	}
+
+	/**
+	 * \brief Send an element over the connection.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 * Fails only when the ceiling of chunks is reached.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(const Type& element) final override
+	{
+		return CopyIn<Type>::send(*this, element);
+	}
+
+	/**
+	 * \brief Send an element over the connection by moving it.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(Type&& element) final override
+	{
+		bool success = false;
+
+		if (room())
+		{
+			new (&_tail->element(_written)) Type(std::move(element));
+			publish();
+
+			success = true;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Receive an element from the connection.
+	 *
+	 * Can be called concurrently with respect to send().
+	 * The element is moved out of the connection.
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 */
+	bool receive(Type& element) final override
+	{
+		bool success = false;
+
+		if (available())
+		{
+			Type& first = _head->element(_read);
+			element = std::move(first);
+			first.~Type();
+
+			_read++;
+
+			success = true;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Access the next element to be received, in place.
+	 *
+	 * \return The next element to be received.
+	 * 		nullptr if the connection is empty.
+	 */
+	const Type* front() final override
+	{
+		return available() ? &_head->element(_read) : nullptr;
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the connection.
+	 */
+	void pop() final override
+	{
+		_head->element(_read).~Type();
+		_read++;
+	}
+
+	/**
+	 * \brief Is an element available for receiving?
+	 */
+	bool peek() const final override
+	{
+		bool result;
+
+		if (_read < chunkSize)
+		{
+			result = (_read < _head->written.load(std::memory_order_acquire));
+		}
+		else
+		{
+			const Chunk* next = _head->next.load(std::memory_order_acquire);
+			result = (next != nullptr) && (next->written.load(std::memory_order_acquire) > 0);
+		}
+
+		return result;
+	}
+
+	/**
+	 * \brief Is the connection full?
+	 *
+	 * Only when the last chunk is full and no chunk can be added anymore.
+	 * Can be called by the receiver as well, it only reads fields shared by both sides.
+	 */
+	bool full() const final override
+	{
+		return (_tailWritten.load(std::memory_order_acquire) == chunkSize)
+				&& (_spares.load(std::memory_order_acquire) == nullptr)
+				&& !mayAllocate();
+	}
+
+	/**
+	 * \brief The number of chunks currently allocated, in use or spare.
+	 */
+	size_t chunks() const
+	{
+		return _chunks.load(std::memory_order_relaxed);
+	}
+
+private:
+	typedef typename std::aligned_storage<sizeof(Type), alignof(Type)>::type Slot;
+
+	struct Chunk
+	{
+		Slot slots[chunkSize];
+
+		// The number of elements constructed in this chunk, published by the sender.
+		std::atomic<size_t> written;
+
+		// The next chunk of the connection, or the next spare chunk.
+		std::atomic<Chunk*> next;
+
+		Chunk() :
+				written(0),
+				next(nullptr)
+		{
+		}
+
+		Type& element(size_t index)
+		{
+			return reinterpret_cast<Type&>(slots[index]);
+		}
+	};
+
+	const size_t _maxChunks;
+	const size_t _spareChunks;
+
+	// Incremented by the sender, decremented by the receiver.
+	std::atomic<size_t> _chunks;
+
+	// The free-list, pushed by the receiver and popped by the sender.
+	std::atomic<Chunk*> _spares;
+	std::atomic<size_t> _spareCount;
+
+	// The number of elements in the tail chunk, a copy of _written for full().
+	std::atomic<size_t> _tailWritten;
+
+	// Owned by the sender.
+	FLOW_CACHE_ALIGNED Chunk* _tail;
+	size_t _written;
+
+	// Owned by the receiver.
+	FLOW_CACHE_ALIGNED Chunk* _head;
+	size_t _read;
+
+	OutPort<Type>& sender;
+	InPort<Type>& receiver;
+
+	bool mayAllocate() const
+	{
+		return (_maxChunks == 0) || (_chunks.load(std::memory_order_relaxed) < _maxChunks);
+	}
+
+	/**
+	 * \brief Make sure the tail chunk has a free slot, appending a chunk if needed.
+	 */
+	bool room()
+	{
+		bool result = true;
+
+		if (_written == chunkSize)
+		{
+			Chunk* chunk = obtainSpare();
+
+			if (chunk != nullptr)
+			{
+				chunk->written.store(0, std::memory_order_relaxed);
+				chunk->next.store(nullptr, std::memory_order_relaxed);
+			}
+			else if (mayAllocate())
+			{
+				chunk = new Chunk();
+				_chunks.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			if (chunk != nullptr)
+			{
+				// The sender does not touch the old tail after linking the new one,
+				// from then on it belongs to the receiver.
+				_tail->next.store(chunk, std::memory_order_release);
+				_tail = chunk;
+				_written = 0;
+				_tailWritten.store(0, std::memory_order_release);
+			}
+			else
+			{
+				result = false;
+			}
+		}
+
+		return result;
+	}
+
+	void publish()
+	{
+		_written++;
+		_tail->written.store(_written, std::memory_order_release);
+		_tailWritten.store(_written, std::memory_order_release);
+	}
+
+	/**
+	 * \brief Is an element available in the head chunk, moving on to the next chunk if needed?
+	 */
+	bool available()
+	{
+		if (_read == chunkSize)
+		{
+			Chunk* next = _head->next.load(std::memory_order_acquire);
+
+			if (next != nullptr)
+			{
+				recycle(_head);
+
+				_head = next;
+				_read = 0;
+			}
+		}
+
+		return (_read < _head->written.load(std::memory_order_acquire));
+	}
+
+	void recycle(Chunk* chunk)
+	{
+		if (_spareCount.load(std::memory_order_relaxed) < _spareChunks)
+		{
+			_spareCount.fetch_add(1, std::memory_order_relaxed);
+
+			Chunk* top = _spares.load(std::memory_order_relaxed);
+
+			do
+			{
+				chunk->next.store(top, std::memory_order_relaxed);
+			}
+			while (!_spares.compare_exchange_weak(top, chunk,
+					std::memory_order_release, std::memory_order_relaxed));
+		}
+		else
+		{
+			delete chunk;
+			_chunks.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	Chunk* obtainSpare()
+	{
+		Chunk* top = _spares.load(std::memory_order_acquire);
+
+		while ((top != nullptr) && !_spares.compare_exchange_weak(top,
+				top->next.load(std::memory_order_relaxed),
+				std::memory_order_acquire, std::memory_order_acquire))
+		{
+		}
+
+		if (top != nullptr)
+		{
+			_spareCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		return top;
+	}
+
+	friend struct CopyIn<Type>;
+
+	bool copyIn(const Type& element)
+	{
+		bool success = false;
+
+		if (room())
+		{
+			new (&_tail->element(_written)) Type(element);
+			publish();
+
+			success = true;
+		}
+
+		return success;
+	}
+};
+
+/**
+ * \brief Connect an output port to an input port by a connection growing in chunks.
+ *
+ * \tparam chunkSize The number of elements per chunk.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ * \param maxChunks The maximum number of chunks, 0 is unbounded, otherwise at least 2.
+ * \param spareChunks The number of emptied chunks kept for reuse.
+ */
+template<size_t chunkSize = 64, typename Type>
+Connection* connectSegmented(OutPort<Type>& sender, InPort<Type>& receiver,
+		size_t maxChunks = 0, size_t spareChunks = 1)
+{
+	return new ConnectionSegmented<Type, chunkSize>(sender, receiver, maxChunks, spareChunks);
+}
+
+} // namespace Flow
+
+#endif /* FLOW_SEGMENTED_H_ */
@@ -0,0 +1,519 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+
+#ifndef FLOW_SHARED_H_
+#define FLOW_SHARED_H_
+
+#if defined(__unix__)
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "flow.h"
+#include "utility.h"
+
+#if !defined(F_OFD_SETLK)
+#error "A shared connection needs open file description locks (F_OFD_SETLK)."
+#endif
+
+namespace Flow
+{
+
+/**
+ * \brief A connection of some type between component ports in different processes.
+ *
+ * The ring and its counters live in a named POSIX shared memory segment (shm_open()),
+ * each process creates its own half of the connection with the same name and size:
+ * the sending process connects its output port, the receiving process its input port.
+ * Elements are copied into the shared ring once, as by an in-process queue,
+ * no system call is involved in sending or receiving.
+ *
+ * Whichever side comes first creates the segment, zero-filled memory is an empty ring.
+ * Each side holds a lock on the segment for its role (an fcntl() record lock on a byte per role)
+ * while it is attached. The kernel releases the lock when the process ends, also when it crashes.
+ * A side can only attach when its role is not locked, so a process taking over
+ * from a crashed peer continues with the elements left in the ring.
+ * peerAttached() tells whether the role of the other side is locked.
+ * The last side to detach removes the segment. Attaching and detaching are serialized
+ * by a third lock, a side that opened a segment just before it was removed opens it anew.
+ *
+ * The locks belong to the open segment (open file description locks, e.g. Linux),
+ * so both sides can be attached in the same process as well. Process-associated locks
+ * would be released by closing any descriptor of the segment, they are not supported.
+ * A forked child shares the locks of the connections of its parent, as it shares the segment.
+ *
+ * \note Only trivially copyable types can be shared, pointers must not be sent.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ */
+template<typename Type>
+class ConnectionShared :
+		public ConnectionOfType<Type>
+{
+	static_assert(std::is_trivially_copyable<Type>::value,
+			"Only trivially copyable types can be shared between processes.");
+	static_assert(ATOMIC_INT_LOCK_FREE == 2,
+			"The counters in shared memory have to be lock-free.");
+
+public:
+	/**
+	 * \brief Attach the sending side of a shared connection.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param name The name of the shared memory segment, starting with a '/'.
+	 * \param size The amount of elements the connection can buffer,
+	 * 		rounded up to a power of two. Both sides have to use the same size.
+	 */
+	ConnectionShared(OutPort<Type>& sender, const char* name, uint32_t size) :
+			_sender(&sender),
+			_receiver(nullptr)
+	{
+		if (attach(name, size))
+		{
+			sender.connect(this);
+		}
+	}
+
+	/**
+	 * \brief Attach the receiving side of a shared connection.
+	 *
+	 * \param receiver The input port to be connected.
+	 * \param name The name of the shared memory segment, starting with a '/'.
+	 * \param size The amount of elements the connection can buffer,
+	 * 		rounded up to a power of two. Both sides have to use the same size.
+	 */
+	ConnectionShared(InPort<Type>& receiver, const char* name, uint32_t size) :
+			_sender(nullptr),
+			_receiver(&receiver)
+	{
+		if (attach(name, size))
+		{
+			receiver.connect(this);
+		}
+	}
+
+	ConnectionShared(const ConnectionShared&) = delete;
+	ConnectionShared& operator=(const ConnectionShared&) = delete;
+
+	/**
+	 * \brief Destructor, detaches from the segment.
+	 */
+	virtual ~ConnectionShared()
+	{
+		if (attached())
+		{
+			if (_sender != nullptr)
+			{
+				_sender->disconnect();
+			}
+
+			if (_receiver != nullptr)
+			{
+				_receiver->disconnect();
+			}
+
+			// The peer is not attached when its role can be locked.
+			if (lock(LIFECYCLE, true) && lock(peerRole(), false))
+			{
+				shm_unlink(_name);
+			}
+
+			munmap(_header, _bytes);
+		}
+
+		if (_descriptor >= 0)
+		{
+			// Releases all locks.
+			close(_descriptor);
+		}
+	}
+
+	/**
+	 * \brief Is this side attached to the segment?
+	 *
+	 * False if the segment could not be created or mapped, its size does not match
+	 * or another process already holds this side.
+	 */
+	bool attached() const
+	{
+		return _header != nullptr;
+	}
+
+	/**
+	 * \brief Is the other side attached, by a process that is still alive?
+	 *
+	 * The lock of a crashed peer was released by the kernel.
+	 */
+	bool peerAttached() const
+	{
+		return attached() && locked(peerRole());
+	}
+
+	/**
+	 * \brief Send an element over the connection.
+	 *
+	 * Can be called concurrently with respect to receive() in the other process.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(const Type& element) final override
+	{
+		bool success = false;
+
+		const uint32_t enqueued = _header->enqueued.load(std::memory_order_relaxed);
+
+		if (enqueued - _header->dequeued.load(std::memory_order_acquire) < _size)
+		{
+			_data[enqueued & (_size - 1)] = element;
+			_header->enqueued.store(enqueued + 1, std::memory_order_release);
+
+			success = true;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Receive an element from the connection.
+	 *
+	 * Can be called concurrently with respect to send() in the other process.
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 */
+	bool receive(Type& element) final override
+	{
+		bool success = false;
+
+		const uint32_t dequeued = _header->dequeued.load(std::memory_order_relaxed);
+
+		if (_header->enqueued.load(std::memory_order_acquire) != dequeued)
+		{
+			element = _data[dequeued & (_size - 1)];
+			_header->dequeued.store(dequeued + 1, std::memory_order_release);
+
+			success = true;
+		}
+
+		return success;
+	}
+
+	/**
+	 * \brief Is an element available for receiving?
+	 */
+	bool peek() const final override
+	{
+		return _header->enqueued.load(std::memory_order_acquire)
+				!= _header->dequeued.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief Is the connection full?
+	 */
+	bool full() const final override
+	{
+		return _header->enqueued.load(std::memory_order_relaxed)
+				- _header->dequeued.load(std::memory_order_acquire) >= _size;
+	}
+
+private:
+	// The layout of the start of the segment, shared by both processes.
+	struct Header
+	{
+		std::atomic<uint32_t> size;
+		std::atomic<uint32_t> elementSize;
+
+		FLOW_CACHE_ALIGNED std::atomic<uint32_t> enqueued;
+
+		FLOW_CACHE_ALIGNED std::atomic<uint32_t> dequeued;
+	};
+
+	static const size_t NAME_LENGTH = 64;
+
+	// The bytes of the segment locked per role, and to serialize attaching and detaching.
+	static const off_t SENDER = 0;
+	static const off_t RECEIVER = 1;
+	static const off_t LIFECYCLE = 2;
+
+	OutPort<Type>* const _sender;
+	InPort<Type>* const _receiver;
+
+	char _name[NAME_LENGTH] = {};
+	int _descriptor = -1;
+	Header* _header = nullptr;
+	Type* _data = nullptr;
+	uint32_t _size = 0;
+	size_t _bytes = 0;
+
+	off_t ownRole() const
+	{
+		return (_sender != nullptr) ? SENDER : RECEIVER;
+	}
+
+	off_t peerRole() const
+	{
+		return (_sender != nullptr) ? RECEIVER : SENDER;
+	}
+
+	/**
+	 * \brief Lock a byte of the segment, optionally waiting for it to be unlocked.
+	 *
+	 * Waiting is resumed when interrupted by a signal.
+	 */
+	bool lock(off_t byte, bool wait) const
+	{
+		struct flock region = range(F_WRLCK, byte);
+		int result;
+
+		do
+		{
+			result = fcntl(_descriptor, wait ? F_OFD_SETLKW : F_OFD_SETLK, &region);
+		}
+		while ((result != 0) && wait && (errno == EINTR));
+
+		return result == 0;
+	}
+
+	void unlock(off_t byte) const
+	{
+		struct flock region = range(F_UNLCK, byte);
+
+		fcntl(_descriptor, F_OFD_SETLK, &region);
+	}
+
+	/**
+	 * \brief Is a byte of the segment locked by another side?
+	 */
+	bool locked(off_t byte) const
+	{
+		struct flock region = range(F_WRLCK, byte);
+
+		return (fcntl(_descriptor, F_OFD_GETLK, &region) == 0) && (region.l_type != F_UNLCK);
+	}
+
+	static struct flock range(short type, off_t byte)
+	{
+		struct flock region;
+		memset(&region, 0, sizeof(region));
+
+		region.l_type = type;
+		region.l_whence = SEEK_SET;
+		region.l_start = byte;
+		region.l_len = 1;
+
+		return region;
+	}
+
+	/**
+	 * \brief Does the descriptor still refer to the segment of that name?
+	 *
+	 * Not when the segment was removed after opening it.
+	 */
+	bool linked() const
+	{
+		bool result = false;
+		const int descriptor = shm_open(_name, O_RDWR, 0);
+
+		if (descriptor >= 0)
+		{
+			struct stat opened;
+			struct stat named;
+
+			result = (fstat(_descriptor, &opened) == 0) && (fstat(descriptor, &named) == 0)
+					&& (opened.st_dev == named.st_dev) && (opened.st_ino == named.st_ino);
+
+			close(descriptor);
+		}
+
+		return result;
+	}
+
+	static size_t offset()
+	{
+		return ((sizeof(Header) + alignof(Type) - 1) / alignof(Type)) * alignof(Type);
+	}
+
+	bool attach(const char* name, uint32_t size)
+	{
+		assert(size > 0);
+		assert(size <= UINT32_MAX / 2 + 1);
+		assert(strlen(name) < NAME_LENGTH);
+
+		strncpy(_name, name, NAME_LENGTH - 1);
+		_size = roundUpToPowerOf2(size);
+		_bytes = offset() + _size * sizeof(Type);
+
+		bool opened = false;
+
+		while (!opened)
+		{
+			_descriptor = shm_open(name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+
+			if (_descriptor < 0)
+			{
+				return false;
+			}
+
+			if (!lock(LIFECYCLE, true))
+			{
+				close(_descriptor);
+				_descriptor = -1;
+
+				return false;
+			}
+
+			if (linked())
+			{
+				opened = true;
+			}
+			else
+			{
+				// Removed by the last side detaching in between, open it anew.
+				close(_descriptor);
+				_descriptor = -1;
+			}
+		}
+
+		if (lock(ownRole(), false))
+		{
+			map();
+		}
+
+		unlock(LIFECYCLE);
+
+		return attached();
+	}
+
+	/**
+	 * \brief Map the segment, creating it or checking it matches.
+	 */
+	void map()
+	{
+		void* mapping = MAP_FAILED;
+
+		// Growing a new segment zero-fills it, an existing one has to have the same size.
+		struct stat status;
+
+		if ((fstat(_descriptor, &status) == 0)
+				&& ((status.st_size == static_cast<off_t>(_bytes))
+						|| ((status.st_size == 0)
+								&& (ftruncate(_descriptor, static_cast<off_t>(_bytes)) == 0))))
+		{
+			mapping = mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _descriptor, 0);
+		}
+
+		if (mapping != MAP_FAILED)
+		{
+			Header* header = static_cast<Header*>(mapping);
+
+			if (claim(header->size, _size) && claim(header->elementSize, sizeof(Type)))
+			{
+				_header = header;
+				_data = reinterpret_cast<Type*>(static_cast<uint8_t*>(mapping) + offset());
+			}
+			else
+			{
+				munmap(mapping, _bytes);
+			}
+		}
+
+		if (_header == nullptr)
+		{
+			unlock(ownRole());
+		}
+	}
+
+	/**
+	 * \brief Set a field of a fresh segment, or check it matches an existing one.
+	 */
+	static bool claim(std::atomic<uint32_t>& field, uint32_t value)
+	{
+		uint32_t expected = 0;
+
+		return field.compare_exchange_strong(expected, value, std::memory_order_acq_rel)
+				|| (expected == value);
+	}
+};
+
+/**
+ * \brief Connect an output port to a shared memory segment, to be received by another process.
+ *
+ * \param sender The output port to be connected.
+ * \param name The name of the shared memory segment, starting with a '/'.
+ * \param size The amount of elements the connection can buffer, the same for both sides.
+ * \return The connection, nullptr if it could not be attached.
+ */
+template<typename Type>
+Connection* connectShared(OutPort<Type>& sender, const char* name, uint32_t size)
+{
+	ConnectionShared<Type>* connection = new ConnectionShared<Type>(sender, name, size);
+
+	if (!connection->attached())
+	{
+		delete connection;
+		connection = nullptr;
+	}
+
+	return connection;
+}
+
+/**
+ * \brief Connect an input port to a shared memory segment, to receive from another process.
+ *
+ * \param receiver The input port to be connected.
+ * \param name The name of the shared memory segment, starting with a '/'.
+ * \param size The amount of elements the connection can buffer, the same for both sides.
+ * \return The connection, nullptr if it could not be attached.
+ */
+template<typename Type>
+Connection* connectShared(InPort<Type>& receiver, const char* name, uint32_t size)
+{
+	ConnectionShared<Type>* connection = new ConnectionShared<Type>(receiver, name, size);
+
+	if (!connection->attached())
+	{
+		delete connection;
+		connection = nullptr;
+	}
+
+	return connection;
+}
+
+} // namespace Flow
+
+#endif // __unix__
+
+#endif /* FLOW_SHARED_H_ */
@@ -24,6 +24,10 @@
 #ifndef UTILITY_H_
 #define UTILITY_H_
 
+#include <assert.h>
+
+#include <limits>
+
 #ifndef ArraySizeOf
 
 /**
@@ -33,6 +37,41 @@
 
 #endif // ArraySizeOf
 
+#ifndef FLOW_CACHE_LINE_SIZE
+
+/**
+ * \brief Size of a data cache line in bytes.
+ *
+ * Data written by different cores is kept this far apart to prevent false sharing.
+ * Cortex-M microcontrollers have no (coherent) data cache, there it is 0:
+ * no alignment is added.
+ * Define it on the command line to override the default.
+ */
+#if defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M')
+#define FLOW_CACHE_LINE_SIZE 0
+#else
+#define FLOW_CACHE_LINE_SIZE 64
+#endif
+
+#endif // FLOW_CACHE_LINE_SIZE
+
+#ifndef FLOW_CACHE_ALIGNED
+
+/**
+ * \brief Start a group of fields on a cache line of its own.
+ *
+ * Put it on the first field of each group written by a different core.
+ * The object containing such a group is aligned to FLOW_CACHE_LINE_SIZE as well,
+ * allocating it on the heap requires an over-aligned new (C++17 or -faligned-new).
+ */
+#if FLOW_CACHE_LINE_SIZE > 0
+#define FLOW_CACHE_ALIGNED alignas(FLOW_CACHE_LINE_SIZE)
+#else
+#define FLOW_CACHE_ALIGNED
+#endif
+
+#endif // FLOW_CACHE_ALIGNED
+
 #ifndef POW_2
 
 template<class Type>
@@ -43,4 +82,25 @@ constexpr Type POW_2(Type exponent)
 
 #endif
 
+/**
+ * \brief The smallest power of two that is not smaller than the given value.
+ *
+ * \param value The value to be rounded up, the result has to fit in Type.
+ * \param minimum The smallest power of two to return.
+ */
+template<class Type>
+Type roundUpToPowerOf2(Type value, Type minimum = 1)
+{
+	assert(value <= (std::numeric_limits<Type>::max() >> 1) + 1);
+
+	Type powerOf2 = minimum;
+
+	while (powerOf2 < value)
+	{
+		powerOf2 = static_cast<Type>(powerOf2 << 1);
+	}
+
+	return powerOf2;
+}
+
 #endif /* UTILITY_H_ */
@@ -0,0 +1,412 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+
+#ifndef FLOW_WAITABLE_H_
+#define FLOW_WAITABLE_H_
+
+#if defined(__linux__)
+
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <utility>
+
+#include "flow.h"
+#include "utility.h"
+
+namespace Flow
+{
+
+/**
+ * \brief A connection of some type between component ports, on which a thread can wait.
+ *
+ * Behaves as ConnectionFIFO, additionally sendWait() blocks the sender while
+ * the connection is full and receiveWait() blocks the receiver while it is empty.
+ * A component running on its own thread can so sleep without spinning or polling.
+ *
+ * Waiting uses a futex per side. The kernel is only entered when the queue
+ * actually is empty (receiver) or full (sender): a successful send or receive
+ * only checks whether the other side is asleep, and only then wakes it.
+ *
+ * Only available on Linux.
+ *
+ * \note Recommendation: use Flow::connectWaitable() instead.
+ *
+ * \tparam Type The type of the elements sent over the connection.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue, it limits the size.
+ */
+template<typename Type, typename IndexType = uint16_t>
+class ConnectionWaitable :
+		public ConnectionOfType<Type>,
+		protected Queue<Type, IndexType>
+{
+public:
+	/**
+	 * \brief Create a waitable connection between an output and input port.
+	 *
+	 * \param sender The output port to be connected.
+	 * \param receiver The input port to be connected.
+	 * \param size The amount of elements the connection can buffer.
+	 */
+	ConnectionWaitable(OutPort<Type>& sender, InPort<Type>& receiver, IndexType size) :
+			Queue<Type, IndexType>(size),
+			_senderWaiting(0),
+			_receiverWaiting(0),
+			sender(sender),
+			receiver(receiver)
+	{
+		sender.connect(this);
+		receiver.connect(this);
+	}
+
+	ConnectionWaitable(const ConnectionWaitable&) = delete;
+	ConnectionWaitable& operator=(const ConnectionWaitable&) = delete;
+
+	/**
+	 * \brief Destructor.
+	 *
+	 * \remark Neither side may be waiting on the connection anymore.
+	 */
+	virtual ~ConnectionWaitable()
+	{
+		sender.disconnect();
+		receiver.disconnect();
+	}
+
+	/**
+	 * \brief Send an element over the connection.
+	 *
+	 * Can be called concurrently with respect to receive().
+	 * If the buffering capacity of the connection is full the given element is not added.
+	 * Wakes the receiver if it is waiting.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(const Type& element) final override
+	{
+		return sent(CopyIn<Type>::send(*this, element));
+	}
+
+	/**
+	 * \brief Send an element over the connection by moving it.
+	 *
+	 * \param element The element to be sent.
+	 * \return The element was successfully sent.
+	 */
+	bool send(Type&& element) final override
+	{
+		return sent(this->enqueue(std::move(element)));
+	}
+
+	/**
+	 * \brief Receive an element from the connection.
+	 *
+	 * Can be called concurrently with respect to send().
+	 * Wakes the sender if it is waiting.
+	 *
+	 * \param element [output] The received element.
+	 * 		The return value indicates whether the element is valid.
+	 * \return An element was successfully received.
+	 */
+	bool receive(Type& element) final override
+	{
+		return received(this->dequeue(element));
+	}
+
+	/**
+	 * \brief Send a number of consecutive elements over the connection.
+	 *
+	 * \param elements The elements to be sent.
+	 * \param count The number of elements to be sent.
+	 * \return The number of elements that was sent.
+	 */
+	size_t send(const Type* elements, size_t count) final override
+	{
+		return sent(CopyIn<Type>::send(*this, elements, count));
+	}
+
+	/**
+	 * \brief Receive a number of elements from the connection.
+	 *
+	 * \param elements [output] The received elements.
+	 * \param count The maximum number of elements to be received.
+	 * \return The number of elements that was received.
+	 */
+	size_t receive(Type* elements, size_t count) final override
+	{
+		return received(this->dequeue(elements, clamp(count)));
+	}
+
+	/**
+	 * \brief Access the next element to be received, in place.
+	 *
+	 * \return The next element to be received.
+	 * 		nullptr if the connection is empty.
+	 */
+	const Type* front() final override
+	{
+		return Queue<Type, IndexType>::front();
+	}
+
+	/**
+	 * \brief Remove the element obtained by front() from the connection.
+	 */
+	void pop() final override
+	{
+		Queue<Type, IndexType>::pop();
+		received(true);
+	}
+
+	/**
+	 * \brief Send an element, waiting while the connection is full.
+	 *
+	 * Can be called concurrently with respect to receive() and receiveWait().
+	 *
+	 * \param element The element to be sent.
+	 * \param timeout The longest time to wait,
+	 * 		std::chrono::nanoseconds::max() waits without limit.
+	 * \return The element was successfully sent, false on timeout.
+	 */
+	bool sendWait(const Type& element, std::chrono::nanoseconds timeout) final override
+	{
+		return send(element) || wait(_senderWaiting, timeout, [&]()
+		{
+			return send(element);
+		});
+	}
+
+	/**
+	 * \brief Send an element by moving it, waiting while the connection is full.
+	 *
+	 * The element is only moved from when it was sent.
+	 *
+	 * \param element The element to be sent.
+	 * \param timeout The longest time to wait,
+	 * 		std::chrono::nanoseconds::max() waits without limit.
+	 * \return The element was successfully sent, false on timeout.
+	 */
+	bool sendWait(Type&& element, std::chrono::nanoseconds timeout) final override
+	{
+		return send(std::move(element)) || wait(_senderWaiting, timeout, [&]()
+		{
+			return send(std::move(element));
+		});
+	}
+
+	/**
+	 * \brief Receive an element, waiting while the connection is empty.
+	 *
+	 * Can be called concurrently with respect to send() and sendWait().
+	 *
+	 * \param element [output] The received element.
+	 * \param timeout The longest time to wait,
+	 * 		std::chrono::nanoseconds::max() waits without limit.
+	 * \return An element was successfully received, false on timeout.
+	 */
+	bool receiveWait(Type& element, std::chrono::nanoseconds timeout) final override
+	{
+		return receive(element) || wait(_receiverWaiting, timeout, [&]()
+		{
+			return receive(element);
+		});
+	}
+
+	/**
+	 * \brief Is an element available for receiving?
+	 */
+	bool peek() const final override
+	{
+		return !this->isEmpty();
+	}
+
+	/**
+	 * \brief Is the connection full?
+	 */
+	bool full() const final override
+	{
+		return this->isFull();
+	}
+
+private:
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+			"A futex has to be a plain 32 bit word.");
+
+	// 1 while the side is (about to go) asleep, cleared by the other side to wake it.
+	FLOW_CACHE_ALIGNED std::atomic<uint32_t> _senderWaiting;
+	std::atomic<uint32_t> _receiverWaiting;
+
+	OutPort<Type>& sender;
+	InPort<Type>& receiver;
+
+	static IndexType clamp(size_t count)
+	{
+		return static_cast<IndexType>(std::min<size_t>(count,
+				std::numeric_limits<IndexType>::max()));
+	}
+
+	template<typename Result>
+	Result sent(Result result)
+	{
+		if (result)
+		{
+			wake(_receiverWaiting);
+		}
+
+		return result;
+	}
+
+	template<typename Result>
+	Result received(Result result)
+	{
+		if (result)
+		{
+			wake(_senderWaiting);
+		}
+
+		return result;
+	}
+
+	/**
+	 * \brief Retry an attempt, sleeping on the futex of this side in between.
+	 *
+	 * The flag is raised before the last attempt, the other side checks it after
+	 * its own operation. With a full fence on both sides at least one of them
+	 * sees the other, so a wake-up can not get lost.
+	 */
+	template<typename Attempt>
+	static bool wait(std::atomic<uint32_t>& waiting, std::chrono::nanoseconds timeout,
+			Attempt attempt)
+	{
+		const bool forever = (timeout == std::chrono::nanoseconds::max());
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		bool success = false;
+		bool expired = false;
+
+		while (!success && !expired)
+		{
+			waiting.store(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			success = attempt();
+
+			if (!success)
+			{
+				if (forever)
+				{
+					futex(waiting, FUTEX_WAIT_PRIVATE, nullptr);
+				}
+				else
+				{
+					const std::chrono::nanoseconds remaining = timeout
+							- (std::chrono::steady_clock::now() - start);
+
+					expired = (remaining <= std::chrono::nanoseconds::zero());
+
+					if (!expired)
+					{
+						const struct timespec relative =
+						{
+							static_cast<time_t>(remaining.count() / 1000000000),
+							static_cast<long>(remaining.count() % 1000000000)
+						};
+
+						futex(waiting, FUTEX_WAIT_PRIVATE, &relative);
+					}
+				}
+			}
+		}
+
+		waiting.store(0, std::memory_order_relaxed);
+
+		return success;
+	}
+
+	static void wake(std::atomic<uint32_t>& waiting)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (waiting.load(std::memory_order_relaxed) != 0
+				&& waiting.exchange(0, std::memory_order_relaxed) != 0)
+		{
+			futex(waiting, FUTEX_WAKE_PRIVATE, nullptr);
+		}
+	}
+
+	static void futex(std::atomic<uint32_t>& word, int operation, const struct timespec* timeout)
+	{
+		// Waiting returns immediately when the word is no longer 1, so
+		// a wake-up in between the last attempt and the syscall is not missed.
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), operation, 1, timeout, nullptr, 0);
+	}
+
+	friend struct CopyIn<Type>;
+
+	bool copyIn(const Type& element)
+	{
+		return this->enqueue(element);
+	}
+
+	size_t copyIn(const Type* elements, size_t count)
+	{
+		return this->enqueue(elements, clamp(count));
+	}
+};
+
+/**
+ * \brief Connect an output port to an input port, allowing both sides to wait.
+ *
+ * \tparam Type The type of the elements.
+ * \tparam IndexType The unsigned type of the indices and counters of the queue, it limits the size.
+ * \param sender The output port to be connected.
+ * \param receiver The input port to be connected.
+ * \param size The amount of elements the connection can buffer.
+ * \return The connection, nullptr if the index type cannot hold the size.
+ */
+template<typename Type, typename IndexType = uint16_t>
+Connection* connectWaitable(OutPort<Type>& sender, InPort<Type>& receiver, size_t size = 1)
+{
+	Connection* connection = nullptr;
+
+	if (size <= std::numeric_limits<IndexType>::max())
+	{
+		connection = new ConnectionWaitable<Type, IndexType>(sender, receiver,
+				static_cast<IndexType>(size));
+	}
+
+	return connection;
+}
+
+} // namespace Flow
+
+#endif // __linux__
+
+#endif /* FLOW_WAITABLE_H_ */
@@ -0,0 +1,298 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <string.h>
+
+#include "flow/record.h"
+
+namespace Flow {
+
+ConnectionRecord::ConnectionRecord(OutRecord& sender, InRecord& receiver, size_t size) :
+		sender(sender),
+		receiver(receiver),
+		_buffer(new uint32_t[(size + HEADER - 1) / HEADER]),
+		_data(reinterpret_cast<uint8_t*>(_buffer)),
+		_size(((size + HEADER - 1) / HEADER) * HEADER),
+		_write(0),
+		_watermark(_size),
+		_reserved(0),
+		_reservedSize(0),
+		_reserving(false),
+		_wrapping(false),
+		_read(0)
+{
+	assert(size > HEADER);
+
+	sender.connect(this);
+	receiver.connect(this);
+}
+
+ConnectionRecord::~ConnectionRecord()
+{
+	sender.disconnect();
+	receiver.disconnect();
+
+	delete[] _buffer;
+}
+
+uint8_t* ConnectionRecord::reserve(size_t size)
+{
+	const size_t needed = footprint(size);
+	const size_t write = _write.load(std::memory_order_relaxed);
+	const size_t read = _read.load(std::memory_order_acquire);
+
+	_reserving = true;
+
+	if(write >= read)
+	{
+		// The records are in one region, try to append at the end, else wrap.
+		// After wrapping the write position must stay behind the read position,
+		// equal positions mean empty.
+		if(_size - write >= needed)
+		{
+			_reserved = write;
+			_wrapping = false;
+		}
+		else if(read > needed)
+		{
+			_reserved = 0;
+			_wrapping = true;
+		}
+		else
+		{
+			_reserving = false;
+		}
+	}
+	else
+	{
+		// Wrapped, the room ends just before the receiver.
+		if(read - write > needed)
+		{
+			_reserved = write;
+			_wrapping = false;
+		}
+		else
+		{
+			_reserving = false;
+		}
+	}
+
+	_reservedSize = size;
+
+	return _reserving ? &_data[_reserved + HEADER] : nullptr;
+}
+
+void ConnectionRecord::commit(size_t size)
+{
+	assert(!_reserving || size <= _reservedSize);
+
+	if(_reserving && size > 0)
+	{
+		const uint32_t header = static_cast<uint32_t>(size);
+		memcpy(&_data[_reserved], &header, HEADER);
+
+		if(_wrapping)
+		{
+			_watermark.store(_write.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		_write.store(_reserved + footprint(size), std::memory_order_release);
+	}
+
+	_reserving = false;
+}
+
+bool ConnectionRecord::send(const uint8_t* data, size_t size)
+{
+	uint8_t* region = reserve(size);
+
+	if(region != nullptr)
+	{
+		memcpy(region, data, size);
+		commit(size);
+	}
+
+	return region != nullptr;
+}
+
+Span<const uint8_t> ConnectionRecord::front()
+{
+	Span<const uint8_t> record;
+
+	size_t read = _read.load(std::memory_order_relaxed);
+	const size_t write = _write.load(std::memory_order_acquire);
+	size_t end = write;
+
+	if(write < read)
+	{
+		// The sender wrapped, the records before the wrap end at the watermark.
+		end = _watermark.load(std::memory_order_relaxed);
+
+		if(read == end)
+		{
+			read = 0;
+			end = write;
+			_read.store(read, std::memory_order_release);
+		}
+	}
+
+	if(read < end)
+	{
+		record.data = &_data[read + HEADER];
+		record.size = length(read);
+	}
+
+	return record;
+}
+
+void ConnectionRecord::pop()
+{
+	const size_t read = _read.load(std::memory_order_relaxed);
+
+	_read.store(read + footprint(length(read)), std::memory_order_release);
+}
+
+bool ConnectionRecord::peek() const
+{
+	const size_t read = _read.load(std::memory_order_relaxed);
+	const size_t write = _write.load(std::memory_order_acquire);
+
+	return (write >= read) ?
+			(read < write) :
+			((read < _watermark.load(std::memory_order_relaxed)) || (write > 0));
+}
+
+size_t ConnectionRecord::footprint(size_t size)
+{
+	return ((HEADER + size + HEADER - 1) / HEADER) * HEADER;
+}
+
+uint32_t ConnectionRecord::length(size_t position) const
+{
+	uint32_t header;
+	memcpy(&header, &_data[position], HEADER);
+
+	return header;
+}
+
+InRecord::InRecord(Component* owner) :
+		Peek(owner)
+{
+}
+
+Span<const uint8_t> InRecord::front()
+{
+	return this->isConnected() ? this->connection->front() : Span<const uint8_t>();
+}
+
+void InRecord::pop()
+{
+	if(this->isConnected())
+	{
+		this->connection->pop();
+	}
+}
+
+bool InRecord::peek() const
+{
+	return this->isConnected() ? this->connection->peek() : false;
+}
+
+void InRecord::connect(ConnectionRecord* connection)
+{
+	assert(!isConnected());
+	this->connection = connection;
+}
+
+void InRecord::disconnect()
+{
+	this->connection = nullptr;
+}
+
+bool InRecord::isConnected() const
+{
+	return this->connection != nullptr;
+}
+
+uint8_t* OutRecord::reserve(size_t size)
+{
+	return this->isConnected() ? this->connection->reserve(size) : nullptr;
+}
+
+void OutRecord::commit(size_t size)
+{
+	if(this->isConnected())
+	{
+		this->connection->commit(size);
+	}
+}
+
+bool OutRecord::send(const uint8_t* data, size_t size)
+{
+	return this->isConnected() ? this->connection->send(data, size) : false;
+}
+
+void OutRecord::connect(ConnectionRecord* connection)
+{
+	assert(!isConnected());
+	this->connection = connection;
+}
+
+void OutRecord::disconnect()
+{
+	this->connection = nullptr;
+}
+
+bool OutRecord::isConnected() const
+{
+	return this->connection != nullptr;
+}
+
+Connection* connect(OutRecord& sender, InRecord& receiver, size_t size)
+{
+	return new ConnectionRecord(sender, receiver, size);
+}
+
+Connection* connect(OutRecord* sender, InRecord& receiver, size_t size)
+{
+	assert(sender != nullptr);
+
+	return new ConnectionRecord(*sender, receiver, size);
+}
+
+Connection* connect(OutRecord& sender, InRecord* receiver, size_t size)
+{
+	assert(receiver != nullptr);
+
+	return new ConnectionRecord(sender, *receiver, size);
+}
+
+Connection* connect(OutRecord* sender, InRecord* receiver, size_t size)
+{
+	assert(sender != nullptr);
+	assert(receiver != nullptr);
+
+	return new ConnectionRecord(*sender, *receiver, size);
+}
+
+} // namespace Flow
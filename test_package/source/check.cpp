@@ -23,5 +23,15 @@
 
 #include "flow/components.h"
 #include "flow/flow.h"
+#include "flow/mailbox.h"
+#include "flow/manytomany.h"
+#include "flow/manytoone.h"
+#include "flow/multicast.h"
+#include "flow/overwrite.h"
 #include "flow/pool.h"
+#include "flow/priority.h"
+#include "flow/record.h"
+#include "flow/segmented.h"
+#include "flow/shared.h"
 #include "flow/utility.h"
+#include "flow/waitable.h"
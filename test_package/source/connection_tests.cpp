@@ -127,6 +127,42 @@ TEST(ConnectionOfType_TestBench, FullConnection)
 	CHECK(!unitUnderTest->receive(response));
 }
 
+TEST(ConnectionOfType_TestBench, SendReceiveBlock)
+{
+	const unsigned int BLOCK = 64;
+	Data stimulus[BLOCK];
+	Data response[BLOCK];
+
+	for (unsigned int c = 0; c < BLOCK; c++)
+	{
+		stimulus[c] = Data(c, true);
+	}
+
+	for (unsigned int round = 0; round < (2 * CONNECTION_FIFO_SIZE / BLOCK); round++)
+	{
+		CHECK(sender.send(stimulus, BLOCK) == BLOCK);
+		CHECK(receiver.peek());
+		CHECK(receiver.receive(response, BLOCK) == BLOCK);
+		CHECK(!receiver.peek());
+
+		for (unsigned int c = 0; c < BLOCK; c++)
+		{
+			CHECK(response[c] == stimulus[c]);
+		}
+	}
+
+	// Sending more than the connection can buffer.
+	size_t sent = 0;
+	while (!receiver.full())
+	{
+		sent += sender.send(stimulus, BLOCK);
+	}
+	CHECK(sent == CONNECTION_FIFO_SIZE);
+	CHECK(sender.send(stimulus, BLOCK) == 0);
+	CHECK(receiver.receive(response, BLOCK) == BLOCK);
+	CHECK(sender.send(stimulus, BLOCK) == BLOCK);
+}
+
 static void producer(ConnectionFIFO<Data>* _unitUnderTest,
 		const unsigned long long count)
 {
@@ -173,3 +209,122 @@ TEST(ConnectionOfType_TestBench, Threadsafe)
 	// Connection should be empty.
 	CHECK(!unitUnderTest->peek());
 }
+
+TEST(ConnectionOfType_TestBench, StaticConnection)
+{
+	OutPort<Data> staticSender;
+	InPort<Data> staticReceiver{ nullptr };
+
+	Flow::Connection* connection = Flow::connect<4>(staticSender, staticReceiver);
+
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		CHECK(!staticReceiver.full());
+		CHECK(staticSender.send(Data(c, true)));
+	}
+
+	CHECK(staticReceiver.full());
+	CHECK(!staticSender.send(Data()));
+
+	Data response;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		CHECK(staticReceiver.receive(response));
+		CHECK(response == Data(c, true));
+	}
+
+	CHECK(!staticReceiver.peek());
+
+	Flow::disconnect(connection);
+
+	CHECK(!staticSender.send(Data()));
+}
+
+TEST(ConnectionOfType_TestBench, StaticConnectionDefinedByCaller)
+{
+	OutPort<Data> staticSender;
+	InPort<Data> staticReceiver{ nullptr };
+
+	{
+		// No heap involved, the connection lives where it is defined.
+		Flow::StaticConnectionFIFO<Data, 2> connection(staticSender, staticReceiver);
+
+		CHECK(staticSender.send(Data(1, true)));
+		CHECK(staticSender.send(Data(2, true)));
+		CHECK(staticReceiver.full());
+
+		Data response;
+		CHECK(staticReceiver.receive(response));
+		CHECK(response == Data(1, true));
+	}
+
+	// The connection disconnected the ports when it went out of scope.
+	CHECK(!staticSender.send(Data()));
+}
+
+TEST(ConnectionOfType_TestBench, ExplicitTypeAndSize)
+{
+	OutPort<Data> explicitSender;
+	InPort<Data> explicitReceiver{ nullptr };
+
+	// The element type comes first, the index type defaults to 16 bit.
+	Flow::Connection* connection = Flow::connect<Data>(explicitSender, explicitReceiver, 3);
+	CHECK(connection != nullptr);
+	CHECK(explicitSender.send(Data(1, true)));
+	Flow::disconnect(connection);
+
+	// A size the index type cannot hold is refused instead of truncated.
+	CHECK(Flow::connect<Data>(explicitSender, explicitReceiver, 70000) == nullptr);
+	CHECK((Flow::connect<Data, uint8_t>(explicitSender, explicitReceiver, 256) == nullptr));
+	CHECK(!explicitSender.send(Data(2, true)));
+}
+
+TEST(ConnectionOfType_TestBench, WideConnection)
+{
+	const size_t size = 70000;
+	OutPort<uint32_t> wideSender;
+	InPort<uint32_t> wideReceiver{ nullptr };
+
+	Flow::Connection* connection = Flow::connect<uint32_t, uint32_t>(wideSender, wideReceiver, size);
+
+	for (uint32_t c = 0; c < size; c++)
+	{
+		CHECK(wideSender.send(c));
+	}
+
+	CHECK(wideReceiver.full());
+	CHECK(!wideSender.send(0));
+
+	uint32_t response;
+	for (uint32_t c = 0; c < size; c++)
+	{
+		CHECK(wideReceiver.receive(response));
+		CHECK(response == c);
+	}
+
+	CHECK(!wideReceiver.peek());
+
+	Flow::disconnect(connection);
+}
+
+TEST(ConnectionOfType_TestBench, Instrumentation)
+{
+	OutPort<Data> instrumentedSender;
+	InPort<Data> instrumentedReceiver{ nullptr };
+	ConnectionFIFO<Data, Flow::Queue<Data, uint16_t, Flow::OccupancyStatistics<uint16_t>>> connection(
+			instrumentedSender, instrumentedReceiver, 4);
+
+	CHECK(instrumentedSender.send(Data(1, true)));
+	CHECK(instrumentedSender.send(Data(2, true)));
+
+	Data response;
+	CHECK(instrumentedReceiver.receive(response));
+
+	CHECK(instrumentedSender.send(Data(3, true)));
+	CHECK(instrumentedSender.send(Data(4, true)));
+	CHECK(instrumentedSender.send(Data(5, true)));
+	CHECK(!instrumentedSender.send(Data(6, true)));
+
+	CHECK(connection.instrumentation().highWatermark() == 4);
+	CHECK(connection.instrumentation().rejectedFull() == 1);
+}
@@ -0,0 +1,128 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <stdint.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/mailbox.h"
+
+#include "data.h"
+
+using Flow::Connection;
+using Flow::OutPort;
+using Flow::InPort;
+
+TEST_GROUP(Mailbox_TestBench)
+{
+	OutPort<Data> sender;
+	InPort<Data> receiver{ nullptr };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connectMailbox(sender, receiver);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(Mailbox_TestBench, IsEmptyAfterCreation)
+{
+	Data response(123, true);
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+	CHECK(response == Data(123, true));
+	CHECK(receiver.front() == nullptr);
+	CHECK(!sender.full());
+}
+
+TEST(Mailbox_TestBench, KeepsTheLatestValue)
+{
+	Data response;
+
+	for (unsigned int c = 0; c < 10; c++)
+	{
+		CHECK(!sender.full());
+		CHECK(sender.send(Data(c, true)));
+	}
+
+	CHECK(receiver.peek());
+	CHECK(receiver.receive(response));
+	CHECK(response == Data(9, true));
+
+	// Not updated, but still the latest value.
+	CHECK(!receiver.peek());
+	response = Data();
+	CHECK(!receiver.receive(response));
+	CHECK(response == Data(9, true));
+	CHECK(*receiver.front() == Data(9, true));
+
+	CHECK(sender.send(Data(10, false)));
+	CHECK(*receiver.front() == Data(10, false));
+	CHECK(!receiver.receive(response));
+	CHECK(response == Data(10, false));
+}
+
+static void producer(OutPort<uint64_t>* sender, const uint64_t count)
+{
+	for (uint64_t c = 1; c <= count; c++)
+	{
+		sender->send(c);
+	}
+}
+
+TEST(Mailbox_TestBench, Threadsafe)
+{
+	OutPort<uint64_t> threadSender;
+	InPort<uint64_t> threadReceiver{ nullptr };
+	Connection* threaded = Flow::connectMailbox(threadSender, threadReceiver);
+
+	const uint64_t count = 1000000;
+	std::thread producerThread(producer, &threadSender, count);
+
+	// The values only go up, until the last one arrives.
+	uint64_t latest = 0;
+	bool success = true;
+
+	while (latest < count)
+	{
+		uint64_t response = 0;
+		if (threadReceiver.receive(response))
+		{
+			success = success && (response > latest);
+			latest = response;
+		}
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+	CHECK(!threadReceiver.peek());
+
+	Flow::disconnect(threaded);
+}
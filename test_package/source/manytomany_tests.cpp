@@ -0,0 +1,197 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/manytomany.h"
+
+#include "data.h"
+
+using Flow::Connection;
+using Flow::OutPort;
+using Flow::InPort;
+
+const static unsigned int SENDERS = 2;
+const static unsigned int RECEIVERS = 3;
+
+TEST_GROUP(ManyToMany_TestBench)
+{
+	OutPort<Data> out[SENDERS];
+	OutPort<Data>* senders[SENDERS] = { &out[0], &out[1] };
+	InPort<Data> in[RECEIVERS] = { InPort<Data>{ nullptr }, InPort<Data>{ nullptr }, InPort<Data>{ nullptr } };
+	InPort<Data>* receivers[RECEIVERS] = { &in[0], &in[1], &in[2] };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connect(senders, receivers, 4);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(ManyToMany_TestBench, IsEmptyAfterCreation)
+{
+	Data response;
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		CHECK(!in[r].peek());
+		CHECK(!in[r].receive(response));
+	}
+	CHECK(!out[0].full());
+}
+
+TEST(ManyToMany_TestBench, SendReceive)
+{
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		CHECK(!out[0].full());
+		CHECK(out[c % SENDERS].send(Data(c, true)));
+	}
+
+	CHECK(out[0].full());
+	CHECK(in[2].full());
+	CHECK(!out[1].send(Data()));
+
+	// Each element is received once, by whichever input port asks.
+	Data response;
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		CHECK(in[0].peek());
+		CHECK(in[c % RECEIVERS].receive(response));
+		CHECK(response == Data(c, true));
+	}
+
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		CHECK(!in[r].peek());
+		CHECK(!in[r].receive(response));
+	}
+}
+
+TEST(ManyToMany_TestBench, WrapAround)
+{
+	Data response;
+	for (unsigned int c = 0; c < 1000; c++)
+	{
+		CHECK(out[c % SENDERS].send(Data(c, false)));
+		CHECK(out[(c + 1) % SENDERS].send(Data(c + 1, true)));
+		CHECK(in[c % RECEIVERS].receive(response));
+		CHECK(response == Data(c, false));
+		CHECK(in[(c + 1) % RECEIVERS].receive(response));
+		CHECK(response == Data(c + 1, true));
+	}
+}
+
+TEST(ManyToMany_TestBench, MoveOnly)
+{
+	OutPort<std::unique_ptr<Data>> sender;
+	OutPort<std::unique_ptr<Data>>* moveOnlySenders[] = { &sender };
+	InPort<std::unique_ptr<Data>> receiver{ nullptr };
+	InPort<std::unique_ptr<Data>>* moveOnlyReceivers[] = { &receiver };
+	Connection* moveOnly = Flow::connect(moveOnlySenders, moveOnlyReceivers, 2);
+
+	CHECK(sender.emplace(new Data(1, true)));
+	CHECK(sender.emplace(new Data(2, true)));
+	CHECK(!sender.emplace(nullptr));
+
+	std::unique_ptr<Data> response;
+	CHECK(receiver.receive(response));
+	CHECK(*response == Data(1, true));
+
+	// Remaining elements are destroyed with the connection.
+	Flow::disconnect(moveOnly);
+}
+
+static void producer(OutPort<uint64_t>* sender, uint64_t first, const uint64_t count)
+{
+	for (uint64_t c = first; c < first + count; c++)
+	{
+		while (!sender->send(c))
+			;
+	}
+}
+
+static void worker(InPort<uint64_t>* receiver, std::atomic<uint64_t>* received, uint64_t* sum,
+		const uint64_t total)
+{
+	while (received->load() < total)
+	{
+		uint64_t response;
+		if (receiver->receive(response))
+		{
+			*sum += response;
+			received->fetch_add(1);
+		}
+	}
+}
+
+TEST(ManyToMany_TestBench, Threadsafe)
+{
+	OutPort<uint64_t> threadOut[SENDERS];
+	OutPort<uint64_t>* threadSenders[SENDERS] = { &threadOut[0], &threadOut[1] };
+	InPort<uint64_t> threadIn[RECEIVERS] = { InPort<uint64_t>{ nullptr }, InPort<uint64_t>{ nullptr },
+			InPort<uint64_t>{ nullptr } };
+	InPort<uint64_t>* threadReceivers[RECEIVERS] = { &threadIn[0], &threadIn[1], &threadIn[2] };
+	Connection* threaded = Flow::connect(threadSenders, threadReceivers, 1024);
+
+	const uint64_t count = 100000;
+	const uint64_t total = SENDERS * count;
+	std::atomic<uint64_t> received(0);
+	uint64_t sum[RECEIVERS] = { 0, 0, 0 };
+	std::thread producerThread[SENDERS];
+	std::thread workerThread[RECEIVERS];
+
+	for (unsigned int s = 0; s < SENDERS; s++)
+	{
+		producerThread[s] = std::thread(producer, &threadOut[s], s * count, count);
+	}
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		workerThread[r] = std::thread(worker, &threadIn[r], &received, &sum[r], total);
+	}
+
+	for (unsigned int s = 0; s < SENDERS; s++)
+	{
+		producerThread[s].join();
+	}
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		workerThread[r].join();
+	}
+
+	// Every element was received exactly once.
+	CHECK(received.load() == total);
+	CHECK(sum[0] + sum[1] + sum[2] == total * (total - 1) / 2);
+	CHECK(!threadIn[0].peek());
+
+	Flow::disconnect(threaded);
+}
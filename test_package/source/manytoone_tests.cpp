@@ -0,0 +1,196 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <memory>
+#include <stdint.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/manytoone.h"
+
+#include "data.h"
+
+using Flow::Connection;
+using Flow::OutPort;
+using Flow::InPort;
+
+const static unsigned int SENDERS = 3;
+
+TEST_GROUP(ManyToOne_TestBench)
+{
+	OutPort<Data> out[SENDERS];
+	OutPort<Data>* senders[SENDERS] = { &out[0], &out[1], &out[2] };
+	InPort<Data> receiver{ nullptr };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connect(senders, receiver, 5);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(ManyToOne_TestBench, IsEmptyAfterCreation)
+{
+	Data response;
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+	CHECK(!out[0].full());
+}
+
+TEST(ManyToOne_TestBench, SendReceive)
+{
+	// The size is rounded up to a power of two.
+	for (unsigned int c = 0; c < 8; c++)
+	{
+		CHECK(!receiver.full());
+		CHECK(out[c % SENDERS].send(Data(c, true)));
+	}
+
+	CHECK(receiver.full());
+	for (unsigned int s = 0; s < SENDERS; s++)
+	{
+		CHECK(!out[s].send(Data()));
+	}
+
+	Data response;
+	for (unsigned int c = 0; c < 8; c++)
+	{
+		CHECK(receiver.receive(response));
+		CHECK(response == Data(c, true));
+	}
+
+	CHECK(!receiver.receive(response));
+}
+
+TEST(ManyToOne_TestBench, FrontPop)
+{
+	CHECK(receiver.front() == nullptr);
+
+	CHECK(out[2].send(Data(1, true)));
+	const Data* element = receiver.front();
+	CHECK(element != nullptr);
+	CHECK(*element == Data(1, true));
+	receiver.pop();
+
+	CHECK(receiver.front() == nullptr);
+}
+
+TEST(ManyToOne_TestBench, Disconnect)
+{
+	Flow::disconnect(connection);
+
+	for (unsigned int s = 0; s < SENDERS; s++)
+	{
+		CHECK(!out[s].send(Data()));
+	}
+
+	connection = Flow::connect(senders, &receiver, 2);
+
+	CHECK(out[1].send(Data(2, false)));
+	Data response;
+	CHECK(receiver.receive(response));
+	CHECK(response == Data(2, false));
+}
+
+TEST(ManyToOne_TestBench, MoveOnly)
+{
+	OutPort<std::unique_ptr<Data>> first, second;
+	OutPort<std::unique_ptr<Data>>* moveOnlySenders[] = { &first, &second };
+	InPort<std::unique_ptr<Data>> moveOnlyReceiver{ nullptr };
+	Connection* moveOnly = Flow::connect(moveOnlySenders, moveOnlyReceiver, 2);
+
+	std::unique_ptr<Data> stimulus(new Data(1, true));
+	CHECK(first.send(std::move(stimulus)));
+	CHECK(second.emplace(new Data(2, false)));
+
+	std::unique_ptr<Data> rejected(new Data(3, true));
+	CHECK(!first.send(std::move(rejected)));
+	CHECK(rejected != nullptr);
+
+	std::unique_ptr<Data> response;
+	CHECK(moveOnlyReceiver.receive(response));
+	CHECK(*response == Data(1, true));
+	CHECK(moveOnlyReceiver.receive(response));
+	CHECK(*response == Data(2, false));
+
+	// Remaining elements are destroyed with the connection.
+	CHECK(first.emplace(new Data(4, true)));
+	Flow::disconnect(moveOnly);
+}
+
+static void producer(OutPort<uint64_t>* sender, uint64_t id, const uint64_t count)
+{
+	for (uint64_t c = 0; c < count; c++)
+	{
+		while (!sender->send((id << 32) | c))
+			;
+	}
+}
+
+TEST(ManyToOne_TestBench, Threadsafe)
+{
+	OutPort<uint64_t> threadOut[SENDERS];
+	OutPort<uint64_t>* threadSenders[SENDERS] = { &threadOut[0], &threadOut[1], &threadOut[2] };
+	InPort<uint64_t> threadReceiver{ nullptr };
+	Connection* threaded = Flow::connect(threadSenders, threadReceiver, 1024);
+
+	const uint64_t count = 100000;
+	std::thread producerThread[SENDERS];
+
+	for (unsigned int s = 0; s < SENDERS; s++)
+	{
+		producerThread[s] = std::thread(producer, &threadOut[s], s, count);
+	}
+
+	// The elements of each producer arrive in the order they were sent.
+	uint64_t expected[SENDERS] = { 0, 0, 0 };
+	uint64_t received = 0;
+	bool inOrder = true;
+
+	while (received < SENDERS * count)
+	{
+		uint64_t response;
+		if (threadReceiver.receive(response))
+		{
+			const uint64_t id = response >> 32;
+			inOrder = inOrder && (id < SENDERS) && ((response & UINT32_MAX) == expected[id]++);
+			received++;
+		}
+	}
+
+	for (unsigned int s = 0; s < SENDERS; s++)
+	{
+		producerThread[s].join();
+	}
+
+	CHECK(inOrder);
+	CHECK(!threadReceiver.peek());
+
+	Flow::disconnect(threaded);
+}
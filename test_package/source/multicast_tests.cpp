@@ -0,0 +1,187 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <stdint.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/multicast.h"
+
+#include "data.h"
+
+using Flow::Connection;
+using Flow::OutPort;
+using Flow::InPort;
+
+const static unsigned int RECEIVERS = 3;
+
+TEST_GROUP(Multicast_TestBench)
+{
+	OutPort<Data> sender;
+	InPort<Data> in[RECEIVERS] = { InPort<Data>{ nullptr }, InPort<Data>{ nullptr }, InPort<Data>{ nullptr } };
+	InPort<Data>* receivers[RECEIVERS] = { &in[0], &in[1], &in[2] };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connect(sender, receivers, 4);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(Multicast_TestBench, IsEmptyAfterCreation)
+{
+	Data response;
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		CHECK(!in[r].peek());
+		CHECK(!in[r].receive(response));
+		CHECK(!in[r].full());
+	}
+	CHECK(!sender.full());
+}
+
+TEST(Multicast_TestBench, EveryReceiverReceivesEveryElement)
+{
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		CHECK(sender.send(Data(c, true)));
+	}
+
+	CHECK(sender.full());
+	CHECK(!sender.send(Data()));
+
+	Data response;
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		CHECK(in[r].full());
+
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			CHECK(in[r].receive(response));
+			CHECK(response == Data(c, true));
+		}
+
+		CHECK(!in[r].receive(response));
+	}
+
+	CHECK(!sender.full());
+}
+
+TEST(Multicast_TestBench, SlowestReceiverGatesTheSender)
+{
+	Data response;
+
+	// Receivers 0 and 1 keep up, receiver 2 does not read at all.
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		CHECK(sender.send(Data(c, false)));
+		CHECK(in[0].receive(response));
+		CHECK(response == Data(c, false));
+		CHECK(in[1].receive(response));
+	}
+
+	CHECK(sender.full());
+	CHECK(!sender.send(Data()));
+
+	// Reading in place frees the oldest element.
+	const Data* element = in[2].front();
+	CHECK(element != nullptr);
+	CHECK(*element == Data(0, false));
+	in[2].pop();
+
+	CHECK(sender.send(Data(4, false)));
+	CHECK(in[2].receive(response));
+	CHECK(response == Data(1, false));
+}
+
+TEST(Multicast_TestBench, Disconnect)
+{
+	Flow::disconnect(connection);
+
+	CHECK(!sender.send(Data()));
+	Data response;
+	CHECK(!in[0].receive(response));
+
+	connection = Flow::connect(&sender, receivers, 2);
+	CHECK(sender.send(Data(1, true)));
+	CHECK(in[1].receive(response));
+	CHECK(response == Data(1, true));
+}
+
+static void producer(OutPort<uint64_t>* sender, const uint64_t count)
+{
+	for (uint64_t c = 0; c < count; c++)
+	{
+		while (!sender->send(c))
+			;
+	}
+}
+
+static void reader(InPort<uint64_t>* receiver, const uint64_t count, bool* success)
+{
+	uint64_t c = 0;
+
+	while (c < count)
+	{
+		uint64_t response;
+		if (receiver->receive(response))
+		{
+			*success = *success && (response == c);
+			c++;
+		}
+	}
+}
+
+TEST(Multicast_TestBench, Threadsafe)
+{
+	OutPort<uint64_t> threadSender;
+	InPort<uint64_t> threadIn[RECEIVERS] = { InPort<uint64_t>{ nullptr }, InPort<uint64_t>{ nullptr },
+			InPort<uint64_t>{ nullptr } };
+	InPort<uint64_t>* threadReceivers[RECEIVERS] = { &threadIn[0], &threadIn[1], &threadIn[2] };
+	Connection* threaded = Flow::connect(threadSender, threadReceivers, 1024);
+
+	const uint64_t count = 100000;
+	bool success[RECEIVERS] = { true, true, true };
+	std::thread readerThread[RECEIVERS];
+
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		readerThread[r] = std::thread(reader, &threadIn[r], count, &success[r]);
+	}
+	std::thread producerThread(producer, &threadSender, count);
+
+	producerThread.join();
+	for (unsigned int r = 0; r < RECEIVERS; r++)
+	{
+		readerThread[r].join();
+		CHECK(success[r]);
+	}
+
+	Flow::disconnect(threaded);
+}
@@ -0,0 +1,171 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <stdint.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/overwrite.h"
+
+using Flow::Connection;
+using Flow::OutPort;
+using Flow::InPort;
+
+TEST_GROUP(Overwrite_TestBench)
+{
+	OutPort<uint32_t> sender;
+	InPort<uint32_t> receiver{ nullptr };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connectOverwrite(sender, receiver, 4);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(Overwrite_TestBench, IsEmptyAfterCreation)
+{
+	uint32_t response;
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+	CHECK(!sender.full());
+	CHECK(receiver.overwritten() == 0);
+}
+
+TEST(Overwrite_TestBench, SendReceive)
+{
+	uint32_t response;
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(sender.send(c));
+	}
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(receiver.receive(response));
+		CHECK(response == c);
+		CHECK(receiver.overwritten() == 0);
+	}
+
+	CHECK(!receiver.receive(response));
+}
+
+TEST(Overwrite_TestBench, KeepsTheMostRecentElements)
+{
+	uint32_t response;
+
+	// Sending never fails, the oldest elements are overwritten.
+	for (uint32_t c = 0; c < 10; c++)
+	{
+		CHECK(!sender.full());
+		CHECK(sender.send(c));
+	}
+
+	CHECK(receiver.receive(response));
+	CHECK(response == 6);
+	CHECK(receiver.overwritten() == 6);
+
+	CHECK(receiver.receive(response));
+	CHECK(response == 7);
+	CHECK(receiver.overwritten() == 0);
+
+	// Overwriting wraps around the ring.
+	for (uint32_t c = 10; c < 15; c++)
+	{
+		CHECK(sender.send(c));
+	}
+
+	CHECK(receiver.receive(response));
+	CHECK(response == 11);
+	CHECK(receiver.overwritten() == 3);
+}
+
+TEST(Overwrite_TestBench, NarrowIndex)
+{
+	// The counters do not wrap with a narrow index type.
+	CHECK((std::is_same<Flow::ConnectionOverwrite<uint32_t, uint16_t>::Counter, uint32_t>::value));
+	CHECK((std::is_same<Flow::ConnectionOverwrite<uint32_t, uint64_t>::Counter, uint64_t>::value));
+
+	OutPort<uint32_t> narrowSender;
+	InPort<uint32_t> narrowReceiver{ nullptr };
+	Connection* narrow = Flow::connectOverwrite<uint16_t>(narrowSender, narrowReceiver, 4);
+
+	for (uint32_t c = 0; c < 70000; c++)
+	{
+		CHECK(narrowSender.send(c));
+	}
+
+	uint32_t response;
+	CHECK(narrowReceiver.receive(response));
+	CHECK(response == 69996);
+	CHECK(narrowReceiver.overwritten() == 69996);
+
+	Flow::disconnect(narrow);
+}
+
+static void producer(OutPort<uint64_t>* sender, const uint64_t count)
+{
+	for (uint64_t c = 0; c < count; c++)
+	{
+		sender->send(c);
+	}
+}
+
+TEST(Overwrite_TestBench, Threadsafe)
+{
+	OutPort<uint64_t> threadSender;
+	InPort<uint64_t> threadReceiver{ nullptr };
+	Connection* threaded = Flow::connectOverwrite(threadSender, threadReceiver, 64);
+
+	const uint64_t count = 1000000;
+	std::thread producerThread(producer, &threadSender, count);
+
+	// Every element is either received, in order, or reported as overwritten.
+	uint64_t expected = 0;
+	bool success = true;
+
+	while (expected < count)
+	{
+		uint64_t response;
+		if (threadReceiver.receive(response))
+		{
+			expected += threadReceiver.overwritten();
+			success = success && (response == expected);
+			expected++;
+		}
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+	CHECK(!threadReceiver.peek());
+
+	Flow::disconnect(threaded);
+}
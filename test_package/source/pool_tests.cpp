@@ -22,16 +22,24 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <thread>
 
 #include "CppUTest/TestHarness.h"
 
+#include "flow/components.h"
+#include "flow/flow.h"
 #include "flow/pool.h"
 #include "flow/utility.h"
 
 #include "data.h"
 
 using Flow::Pool;
+using Flow::PoolCache;
+using Flow::PoolPtr;
+using Flow::SharedPool;
+using Flow::SlabPool;
+using Flow::StaticPool;
 
 const static unsigned int UNITS = 3;
 const static unsigned int POOL_SIZE[UNITS] =
@@ -178,3 +186,531 @@ TEST(Pool_TestBench, Threadsafe)
 		CHECK(unitUnderTest[i]->haveAvailable());
 	}
 }
+
+TEST(Pool_TestBench, LifoMostRecentFirst)
+{
+	Pool<Data, Flow::LifoFreeList<uint16_t>> lifo(3);
+	Data* first = lifo.take();
+	Data* second = lifo.take();
+	Data* third = lifo.take();
+	CHECK(lifo.take() == nullptr);
+	CHECK(!lifo.haveAvailable());
+
+	CHECK(lifo.release(*first));
+	CHECK(lifo.release(*third));
+	CHECK(lifo.take() == third);
+	CHECK(lifo.take() == first);
+
+	CHECK(lifo.release(*second));
+	CHECK(lifo.take() == second);
+
+	// Only elements of the pool can be released.
+	Data foreign;
+	CHECK(!lifo.release(foreign));
+
+	Pool<Data, Flow::LifoFreeList<uint16_t>> copied(lifo);
+	CHECK(!copied.haveAvailable());
+}
+
+static void takeRelease(Pool<uint64_t, Flow::LifoFreeList<uint16_t>>* pool, uint64_t id,
+		const unsigned long long count, bool* success)
+{
+	for (unsigned long long c = 0; c < count; c++)
+	{
+		uint64_t* element;
+		while ((element = pool->take()) == nullptr)
+		{
+			std::this_thread::yield();
+		}
+
+		// Nobody else owns the element meanwhile.
+		*element = id;
+		std::this_thread::yield();
+		*success = *success && (*element == id);
+
+		*success = *success && pool->release(*element);
+	}
+}
+
+TEST(Pool_TestBench, LifoThreadsafe)
+{
+	Pool<uint64_t, Flow::LifoFreeList<uint16_t>> lifo(2);
+	const unsigned long long count = 100000;
+	bool success[3] = { true, true, true };
+
+	std::thread first(takeRelease, &lifo, 1, count, &success[0]);
+	std::thread second(takeRelease, &lifo, 2, count, &success[1]);
+	std::thread third(takeRelease, &lifo, 3, count, &success[2]);
+
+	first.join();
+	second.join();
+	third.join();
+
+	CHECK(success[0] && success[1] && success[2]);
+	CHECK(lifo.take() != nullptr);
+	CHECK(lifo.take() != nullptr);
+	CHECK(lifo.take() == nullptr);
+}
+
+TEST(Pool_TestBench, PoolPtrReturnsToPool)
+{
+	CHECK(sizeof(PoolPtr<Data>) == sizeof(void*));
+
+	SharedPool<Data> shared(2);
+	PoolPtr<Data> first = shared.take();
+	PoolPtr<Data> second = shared.take();
+	CHECK(first && second);
+	CHECK(first != second);
+	CHECK(!shared.take());
+	CHECK(!shared.haveAvailable());
+
+	*first = Data(1, true);
+	PoolPtr<Data> copy = first;
+	CHECK(!first.unique());
+	CHECK(*copy == Data(1, true));
+
+	first.reset();
+	CHECK(!shared.haveAvailable());
+	CHECK(copy.unique());
+
+	copy = second;
+	CHECK(shared.haveAvailable());
+
+	PoolPtr<Data> moved(std::move(second));
+	CHECK(!second);
+	copy.reset();
+	CHECK(moved.unique());
+
+	// A self-move keeps the reference.
+	PoolPtr<Data>& self = moved;
+	moved = std::move(self);
+	CHECK(moved.unique());
+
+	moved = PoolPtr<Data>();
+	CHECK(shared.take() && shared.take());
+}
+
+TEST(Pool_TestBench, PoolPtrThroughSplit)
+{
+	SharedPool<Data> shared(1);
+	Split<PoolPtr<Data>, 2> split;
+	Flow::OutPort<PoolPtr<Data>> sender;
+	Flow::InPort<PoolPtr<Data>> first{ nullptr }, second{ nullptr };
+
+	Flow::Connection* connections[] =
+	{
+		Flow::connect(sender, split.in),
+		Flow::connect(split.out[0], first),
+		Flow::connect(split.out[1], second)
+	};
+
+	PoolPtr<Data> buffer = shared.take();
+	*buffer = Data(42, true);
+	CHECK(sender.send(std::move(buffer)));
+	split.run();
+
+	// Both receive the same element, it is not copied.
+	PoolPtr<Data> firstResponse, secondResponse;
+	CHECK(first.receive(firstResponse));
+	CHECK(second.receive(secondResponse));
+	CHECK(firstResponse == secondResponse);
+	CHECK(*firstResponse == Data(42, true));
+	CHECK(!shared.haveAvailable());
+
+	firstResponse.reset();
+	secondResponse.reset();
+	CHECK(shared.haveAvailable());
+
+	for (Flow::Connection* connection : connections)
+	{
+		Flow::disconnect(connection);
+	}
+}
+
+static void produceShared(SharedPool<uint64_t>* pool, Flow::OutPort<PoolPtr<uint64_t>>* sender,
+		const uint64_t count)
+{
+	for (uint64_t c = 0; c < count; c++)
+	{
+		PoolPtr<uint64_t> element;
+		while (!(element = pool->take()))
+		{
+			std::this_thread::yield();
+		}
+
+		*element = c;
+
+		// The copy is dropped here while the receiver drops the other one.
+		while (!sender->send(element))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+TEST(Pool_TestBench, PoolPtrThreadsafe)
+{
+	SharedPool<uint64_t> shared(4);
+	Flow::OutPort<PoolPtr<uint64_t>> sender;
+	Flow::InPort<PoolPtr<uint64_t>> receiver{ nullptr };
+	Flow::Connection* connection = Flow::connect(sender, receiver, 4);
+
+	const uint64_t count = 100000;
+	std::thread producerThread(produceShared, &shared, &sender, count);
+
+	bool success = true;
+
+	for (uint64_t c = 0; c < count; c++)
+	{
+		PoolPtr<uint64_t> response;
+		while (!receiver.receive(response))
+		{
+			std::this_thread::yield();
+		}
+
+		success = success && (*response == c);
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		CHECK(shared.take());
+	}
+
+	Flow::disconnect(connection);
+}
+
+TEST(Pool_TestBench, BatchTakeRelease)
+{
+	Pool<Data, Flow::LifoFreeList<uint16_t>> lifo(40);
+	Data* elements[50];
+
+	CHECK(lifo.take(elements, 35) == 35);
+	CHECK(lifo.take(&elements[35], 15) == 5);
+	CHECK(!lifo.haveAvailable());
+
+	// As released one by one, the last one is taken first.
+	lifo.release(elements, 40);
+	CHECK(lifo.take() == elements[39]);
+	CHECK(lifo.take() == elements[38]);
+
+	Pool<Data> fifo(3);
+	CHECK(fifo.take(elements, 4) == 3);
+	fifo.release(elements, 3);
+	CHECK(fifo.take() == elements[0]);
+}
+
+TEST(Pool_TestBench, PoolCache)
+{
+	Pool<Data, Flow::LifoFreeList<uint16_t>> depot(20);
+
+	{
+		PoolCache<Pool<Data, Flow::LifoFreeList<uint16_t>>, 8> cache(depot);
+		CHECK(cache.cached() == 0);
+
+		// Refilled with half a magazine.
+		Data* first = cache.take();
+		CHECK(first != nullptr);
+		CHECK(cache.cached() == 3);
+
+		Data* taken[19];
+		taken[0] = first;
+
+		for (unsigned int i = 1; i < 19; i++)
+		{
+			taken[i] = cache.take();
+			CHECK(taken[i] != nullptr);
+		}
+
+		CHECK(cache.cached() == 1);
+		CHECK(!depot.haveAvailable());
+
+		for (unsigned int i = 0; i < 19; i++)
+		{
+			CHECK(cache.release(*taken[i]));
+		}
+
+		// Flushed half a magazine to the depot every time it ran full.
+		CHECK(cache.cached() == 8);
+		CHECK(depot.haveAvailable());
+
+		// The most recently released element is taken first.
+		CHECK(cache.take() == taken[18]);
+		CHECK(cache.release(*taken[18]));
+
+		Data foreign;
+		CHECK(!cache.release(foreign));
+	}
+
+	// The cache returned its elements on destruction.
+	Data* elements[20];
+	CHECK(depot.take(elements, 20) == 20);
+}
+
+static void cachedTakeRelease(Pool<uint64_t, Flow::LifoFreeList<uint16_t>>* depot, uint64_t id,
+		const unsigned long long count, bool* success)
+{
+	PoolCache<Pool<uint64_t, Flow::LifoFreeList<uint16_t>>> cache(*depot);
+	uint64_t* held[4];
+
+	for (unsigned long long c = 0; c < count; c++)
+	{
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			while ((held[i] = cache.take()) == nullptr)
+			{
+				std::this_thread::yield();
+			}
+
+			*held[i] = id;
+		}
+
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			*success = *success && (*held[i] == id);
+			*success = *success && cache.release(*held[i]);
+		}
+	}
+}
+
+TEST(Pool_TestBench, PoolCacheThreadsafe)
+{
+	Pool<uint64_t, Flow::LifoFreeList<uint16_t>> depot(64);
+	const unsigned long long count = 100000;
+	bool success[3] = { true, true, true };
+
+	std::thread first(cachedTakeRelease, &depot, 1, count, &success[0]);
+	std::thread second(cachedTakeRelease, &depot, 2, count, &success[1]);
+	std::thread third(cachedTakeRelease, &depot, 3, count, &success[2]);
+
+	first.join();
+	second.join();
+	third.join();
+
+	CHECK(success[0] && success[1] && success[2]);
+
+	uint64_t* elements[64];
+	CHECK(depot.take(elements, 64) == 64);
+}
+
+static StaticPool<Data, 10> staticPool;
+
+TEST(Pool_TestBench, StaticPool)
+{
+	CHECK((std::is_same<StaticPool<Data, 10>::Index, uint8_t>::value));
+	CHECK((std::is_same<StaticPool<Data, 1024>::Index, uint16_t>::value));
+	CHECK((std::is_same<StaticPool<char, 70000>::Index, uint32_t>::value));
+	CHECK(sizeof(Flow::StaticLifoFreeList<200>) == 200 * sizeof(uint8_t) + sizeof(uint32_t));
+
+	Data* elements[10];
+
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		elements[i] = staticPool.take();
+		CHECK(elements[i] == elements[0] + i);
+	}
+
+	CHECK(staticPool.take() == nullptr);
+	CHECK(!staticPool.haveAvailable());
+
+	// Only elements of the pool can be released.
+	Data foreign;
+	CHECK(!staticPool.release(foreign));
+
+	CHECK(staticPool.release(*elements[3]));
+	CHECK(staticPool.release(*elements[7]));
+	CHECK(staticPool.take() == elements[3]);
+
+	staticPool.release(elements, 3);
+	CHECK(staticPool.take() == elements[7]);
+	CHECK(staticPool.take(elements, 10) == 3);
+	staticPool.release(elements, 3);
+	staticPool.release(&elements[3], 7);
+	CHECK(staticPool.haveAvailable());
+}
+
+// A free-list exposing its top, to look at it as a pop that is overtaken would.
+class ProbedLifoFreeList :
+		public Flow::LifoFreeListBase<uint8_t, ProbedLifoFreeList>
+{
+public:
+	typedef Flow::LifoFreeListBase<uint8_t, ProbedLifoFreeList>::Top Top;
+
+	ProbedLifoFreeList()
+	{
+		link(4);
+	}
+
+	std::atomic<uint8_t>* links()
+	{
+		return _next;
+	}
+
+	/**
+	 * \brief Would the compare-exchange of a pop that read the top earlier succeed?
+	 */
+	bool stale(Top read)
+	{
+		return _top.compare_exchange_strong(read, read);
+	}
+
+	Top top() const
+	{
+		return _top.load();
+	}
+
+private:
+	std::atomic<uint8_t> _next[4];
+};
+
+TEST(Pool_TestBench, LifoTagOutlastsIndex)
+{
+	ProbedLifoFreeList freeList;
+
+	// A pop reads the top, then is overtaken by pops and pushes of the same index.
+	const ProbedLifoFreeList::Top read = freeList.top();
+	uint8_t popped = 0;
+
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		CHECK(freeList.pop(popped));
+		CHECK(popped == 0);
+		CHECK(freeList.push(popped));
+	}
+
+	// The same index is on top again, after 512 modifications an 8-bit tag would have wrapped.
+	CHECK(!freeList.stale(read));
+}
+
+TEST(Pool_TestBench, StaticPoolLifo)
+{
+	StaticPool<Data, 255, Flow::StaticLifoFreeList<255>> lifo;
+	Data* elements[255];
+
+	CHECK(lifo.take(elements, 300) == 255);
+	CHECK(!lifo.haveAvailable());
+
+	lifo.release(*elements[10]);
+	lifo.release(*elements[254]);
+	CHECK(lifo.take() == elements[254]);
+
+	StaticPool<Data, 255, Flow::StaticLifoFreeList<255>> copied(lifo);
+	Data* taken = copied.take();
+	CHECK(copied.contains(*taken));
+	CHECK(!lifo.contains(*taken));
+	CHECK(copied.take() == nullptr);
+}
+
+TEST(Pool_TestBench, StaticPoolCache)
+{
+	StaticPool<Data, 8, Flow::StaticLifoFreeList<8>> depot;
+
+	{
+		PoolCache<StaticPool<Data, 8, Flow::StaticLifoFreeList<8>>, 4> cache(depot);
+
+		Data* first = cache.take();
+		CHECK(depot.contains(*first));
+		CHECK(cache.cached() == 1);
+
+		CHECK(cache.release(*first));
+		CHECK(cache.take() == first);
+		CHECK(cache.release(*first));
+	}
+
+	// The cache returned its elements on destruction.
+	Data* elements[8];
+	CHECK(depot.take(elements, 8) == 8);
+}
+
+TEST(Pool_TestBench, SlabPool)
+{
+	SlabPool<16, 3> slabs({ 4, 2, 1 });
+
+	CHECK((SlabPool<16, 3>::sizeClass(0) == 0));
+	CHECK((SlabPool<16, 3>::sizeClass(16) == 0));
+	CHECK((SlabPool<16, 3>::sizeClass(17) == 1));
+	CHECK((SlabPool<16, 3>::sizeClass(64) == 2));
+	CHECK((SlabPool<16, 3>::sizeClass(65) == 3));
+
+	// Served from the smallest class that fits.
+	void* small = slabs.take(10);
+	void* medium = slabs.take(20);
+	void* large = slabs.take(64);
+	CHECK(slabs.capacity(small) == 16);
+	CHECK(slabs.capacity(medium) == 32);
+	CHECK(slabs.capacity(large) == 64);
+	CHECK(slabs.take(65) == nullptr);
+
+	// The buffers do not overlap.
+	memset(small, 1, 16);
+	memset(medium, 2, 32);
+	memset(large, 3, 64);
+	CHECK(static_cast<uint8_t*>(small)[15] == 1);
+	CHECK(static_cast<uint8_t*>(medium)[31] == 2);
+
+	// When a class runs out, a larger class serves.
+	void* spill = slabs.take(32);
+	CHECK(spill != nullptr);
+	CHECK(slabs.capacity(spill) == 32);
+	CHECK(slabs.take(32) == nullptr);
+	CHECK(!slabs.haveAvailable(17));
+	CHECK(slabs.haveAvailable(16));
+
+	CHECK(slabs.release(large));
+	CHECK(slabs.haveAvailable(17));
+	CHECK(slabs.take(17) == large);
+
+	// Only buffers of the pool can be released.
+	uint8_t foreign[16];
+	CHECK(!slabs.release(foreign));
+	CHECK(!slabs.release(static_cast<uint8_t*>(medium) + 16));
+	CHECK(!slabs.contains(foreign));
+	CHECK(slabs.capacity(foreign) == 0);
+
+	CHECK(slabs.release(small));
+	CHECK(slabs.release(medium));
+	CHECK(slabs.release(spill));
+	CHECK(slabs.release(large));
+}
+
+static void slabTakeRelease(SlabPool<8, 4, Flow::LifoFreeList<uint16_t>>* slabs, uint8_t id,
+		const unsigned long long count, bool* success)
+{
+	for (unsigned long long c = 0; c < count; c++)
+	{
+		const size_t size = 1 + (c * 7) % 64;
+		uint8_t* buffer;
+		while ((buffer = static_cast<uint8_t*>(slabs->take(size))) == nullptr)
+		{
+			std::this_thread::yield();
+		}
+
+		// Nobody else owns the buffer meanwhile.
+		memset(buffer, id, size);
+		std::this_thread::yield();
+		*success = *success && (buffer[0] == id) && (buffer[size - 1] == id);
+
+		*success = *success && slabs->release(buffer);
+	}
+}
+
+TEST(Pool_TestBench, SlabPoolThreadsafe)
+{
+	SlabPool<8, 4, Flow::LifoFreeList<uint16_t>> slabs({ 2, 2, 2, 2 });
+	const unsigned long long count = 20000;
+	bool success[3] = { true, true, true };
+
+	std::thread first(slabTakeRelease, &slabs, 1, count, &success[0]);
+	std::thread second(slabTakeRelease, &slabs, 2, count, &success[1]);
+	std::thread third(slabTakeRelease, &slabs, 3, count, &success[2]);
+
+	first.join();
+	second.join();
+	third.join();
+
+	CHECK(success[0] && success[1] && success[2]);
+	CHECK(slabs.haveAvailable(64));
+}
@@ -21,6 +21,7 @@
  * SOLUTION.
  */
 
+#include <memory>
 #include <stdint.h>
 #include <thread>
 
@@ -180,3 +181,139 @@ TEST(Port_TestBench, Threadsafe)
 
 	CHECK(success);
 }
+
+TEST(Port_TestBench, ReserveCommitFrontPop)
+{
+	CHECK(inUnitUnderTest->front() == nullptr);
+
+	for (unsigned int c = 0; c < CONNECTION_FIFO_SIZE; c++)
+	{
+		Data* element = outUnitUnderTest->reserve();
+		CHECK(element != nullptr);
+		*element = Data(c, true);
+
+		if (c == 0)
+		{
+			// Not sent until committed.
+			CHECK(!inUnitUnderTest->peek());
+		}
+		outUnitUnderTest->commit();
+		CHECK(inUnitUnderTest->peek());
+	}
+
+	CHECK(outUnitUnderTest->full());
+	CHECK(outUnitUnderTest->reserve() == nullptr);
+
+	for (unsigned int c = 0; c < CONNECTION_FIFO_SIZE; c++)
+	{
+		const Data* element = inUnitUnderTest->front();
+		CHECK(element != nullptr);
+		CHECK(*element == Data(c, true));
+
+		// Still there until popped.
+		CHECK(inUnitUnderTest->front() == element);
+		inUnitUnderTest->pop();
+	}
+
+	CHECK(inUnitUnderTest->front() == nullptr);
+	CHECK(!inUnitUnderTest->peek());
+}
+
+TEST(Port_TestBench, ReserveFrontNotConnected)
+{
+	OutPort<Data> sender;
+	InPort<Data> receiver{ nullptr };
+
+	CHECK(sender.reserve() == nullptr);
+	CHECK(receiver.front() == nullptr);
+}
+
+TEST(Port_TestBench, Spans)
+{
+	OutPort<int> sender;
+	InPort<int> receiver{ nullptr };
+	Connection* spans = connect(sender, receiver, 8);
+
+	Flow::Spans<int> writable = sender.writableSpans();
+	CHECK(writable.first.size == 8);
+	CHECK(writable.second.size == 0);
+	for (int c = 0; c < 5; c++)
+	{
+		writable.first.data[c] = c;
+	}
+	CHECK(!receiver.peek());
+	sender.produce(5);
+
+	Flow::Spans<const int> readable = receiver.readableSpans();
+	CHECK(readable.size() == 5);
+	CHECK(readable.first.data[0] == 0);
+	receiver.consume(3);
+
+	// The free slots wrap around the end of the buffer.
+	writable = sender.writableSpans();
+	CHECK(writable.first.size == 3);
+	CHECK(writable.second.size == 3);
+	for (int c = 0; c < 3; c++)
+	{
+		writable.first.data[c] = 5 + c;
+		writable.second.data[c] = 8 + c;
+	}
+	sender.produce(6);
+	CHECK(sender.writableSpans().size() == 0);
+
+	readable = receiver.readableSpans();
+	CHECK(readable.first.size == 5);
+	CHECK(readable.second.size == 3);
+	for (int c = 0; c < 5; c++)
+	{
+		CHECK(readable.first.data[c] == 3 + c);
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		CHECK(readable.second.data[c] == 8 + c);
+	}
+	receiver.consume(readable.size());
+	CHECK(!receiver.peek());
+
+	disconnect(spans);
+
+	CHECK(sender.writableSpans().size() == 0);
+	CHECK(receiver.readableSpans().size() == 0);
+}
+
+TEST(Port_TestBench, SpansNotTrivial)
+{
+	CHECK(outUnitUnderTest->send(Data(1, true)));
+	CHECK(outUnitUnderTest->send(Data(2, true)));
+
+	// Only trivial types can be written in place.
+	CHECK(outUnitUnderTest->writableSpans().size() == 0);
+
+	Flow::Spans<const Data> readable = inUnitUnderTest->readableSpans();
+	CHECK(readable.size() == 2);
+	CHECK(readable.first.data[1] == Data(2, true));
+	inUnitUnderTest->consume(2);
+	CHECK(!inUnitUnderTest->peek());
+}
+
+TEST(Port_TestBench, MoveOnly)
+{
+	OutPort<std::unique_ptr<Data>> sender;
+	InPort<std::unique_ptr<Data>> receiver{ nullptr };
+	Connection* moveOnly = connect(sender, receiver, 2);
+
+	std::unique_ptr<Data> stimulus(new Data(123, true));
+	Data* address = stimulus.get();
+	CHECK(sender.send(std::move(stimulus)));
+	CHECK(sender.emplace(new Data(456, false)));
+	CHECK(!sender.emplace(nullptr));
+
+	std::unique_ptr<Data> response;
+	CHECK(receiver.receive(response));
+	CHECK(response.get() == address);
+	CHECK(receiver.receive(response));
+	CHECK(*response == Data(456, false));
+	CHECK(!receiver.receive(response));
+
+	disconnect(moveOnly);
+}
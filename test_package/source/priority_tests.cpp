@@ -0,0 +1,185 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <memory>
+#include <stdint.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/priority.h"
+
+#include "data.h"
+
+using Flow::Connection;
+using Flow::OutPort;
+using Flow::InPort;
+
+struct Message
+{
+	uint8_t priority;
+	uint32_t value;
+};
+
+static uint8_t priorityOf(const Message& message)
+{
+	return message.priority;
+}
+
+TEST_GROUP(Priority_TestBench)
+{
+	OutPort<Message> sender;
+	InPort<Message> receiver{ nullptr };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connect(sender, receiver, 8, priorityOf);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(Priority_TestBench, IsEmptyAfterCreation)
+{
+	Message response;
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+	CHECK(!sender.full());
+}
+
+TEST(Priority_TestBench, HighestPriorityFirst)
+{
+	const uint8_t priorities[] = { 1, 3, 0, 7, 2, 7, 5, 1 };
+	const uint8_t expected[] = { 7, 7, 5, 3, 2, 1, 1, 0 };
+	Message response;
+
+	for (uint32_t c = 0; c < ArraySizeOf(priorities); c++)
+	{
+		CHECK(sender.send(Message{ priorities[c], c }));
+	}
+
+	CHECK(sender.full());
+	CHECK(!sender.send(Message{ 9, 8 }));
+
+	for (uint32_t c = 0; c < ArraySizeOf(expected); c++)
+	{
+		CHECK(receiver.receive(response));
+		CHECK(response.priority == expected[c]);
+	}
+
+	CHECK(!receiver.peek());
+}
+
+TEST(Priority_TestBench, EqualPrioritiesInOrder)
+{
+	Message response;
+
+	for (uint32_t round = 0; round < 3; round++)
+	{
+		for (uint32_t c = 0; c < 6; c++)
+		{
+			CHECK(sender.send(Message{ 1, round * 6 + c }));
+		}
+
+		// An urgent message overtakes the backlog.
+		CHECK(sender.send(Message{ 2, 100 }));
+
+		CHECK(receiver.receive(response));
+		CHECK(response.value == 100);
+
+		for (uint32_t c = 0; c < 6; c++)
+		{
+			CHECK(receiver.receive(response));
+			CHECK(response.value == round * 6 + c);
+		}
+	}
+}
+
+TEST(Priority_TestBench, MoveOnly)
+{
+	OutPort<std::unique_ptr<Data>> moveOnlySender;
+	InPort<std::unique_ptr<Data>> moveOnlyReceiver{ nullptr };
+	Connection* moveOnly = Flow::connect(moveOnlySender, moveOnlyReceiver, 2,
+			[](const std::unique_ptr<Data>& data) { return *data; });
+
+	std::unique_ptr<Data> stimulus(new Data(1, true));
+	CHECK(moveOnlySender.send(std::move(stimulus)));
+	CHECK(moveOnlySender.emplace(new Data(2, false)));
+
+	std::unique_ptr<Data> rejected(new Data(3, true));
+	CHECK(!moveOnlySender.send(std::move(rejected)));
+	CHECK(rejected != nullptr);
+
+	std::unique_ptr<Data> response;
+	CHECK(moveOnlyReceiver.receive(response));
+	CHECK(*response == Data(2, false));
+
+	// Remaining elements are destroyed with the connection.
+	CHECK(moveOnlySender.send(std::move(rejected)));
+	Flow::disconnect(moveOnly);
+}
+
+static void producer(OutPort<Message>* sender, const uint32_t count)
+{
+	for (uint32_t c = 0; c < count; c++)
+	{
+		while (!sender->send(Message{ static_cast<uint8_t>(c % 4), c }))
+			;
+	}
+}
+
+TEST(Priority_TestBench, Threadsafe)
+{
+	OutPort<Message> threadSender;
+	InPort<Message> threadReceiver{ nullptr };
+	Connection* threaded = Flow::connect(threadSender, threadReceiver, 16, priorityOf);
+
+	const uint32_t count = 1000000;
+	std::thread producerThread(producer, &threadSender, count);
+
+	// Within a priority the messages arrive in order.
+	uint32_t next[4] = { 0, 1, 2, 3 };
+	bool success = true;
+
+	for (uint32_t c = 0; c < count; c++)
+	{
+		Message response;
+
+		while (!threadReceiver.receive(response))
+			;
+
+		success = success && (response.value == next[response.priority]);
+		next[response.priority] += 4;
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+	CHECK(!threadReceiver.peek());
+
+	Flow::disconnect(threaded);
+}
@@ -21,8 +21,17 @@
  * SOLUTION.
  */
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <stdint.h>
+#include <string>
 #include <thread>
+#include <type_traits>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
 
 #include "CppUTest/TestHarness.h"
 
@@ -168,7 +177,8 @@ TEST(Queue_TestBench, FullQueue)
 	}
 }
 
-static void producer(Queue<Data>* queue, const unsigned long long count)
+template<typename QueueType>
+static void producer(QueueType* queue, const unsigned long long count)
 {
 	unsigned long long c = 0;
 	while (c < count)
@@ -180,7 +190,8 @@ static void producer(Queue<Data>* queue, const unsigned long long count)
 	}
 }
 
-static void consumer(Queue<Data>* queue, const unsigned long long count,
+template<typename QueueType>
+static void consumer(QueueType* queue, const unsigned long long count,
 		bool* success)
 {
 	unsigned long long c = 0;
@@ -196,28 +207,245 @@ static void consumer(Queue<Data>* queue, const unsigned long long count,
 	}
 }
 
+/**
+ * \brief Run the producer and the consumer on different cores, when possible.
+ */
+static void pin(std::thread& thread, unsigned int core)
+{
+#ifdef __linux__
+	const unsigned int cores = std::thread::hardware_concurrency();
+
+	if (cores > 1)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core % cores, &set);
+		pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+	}
+#else
+	(void)thread;
+	(void)core;
+#endif
+}
+
+/**
+ * \brief Pass elements from a producer to a consumer thread on different cores,
+ * verify their order and measure the throughput.
+ *
+ * \param rate [output] The throughput in M elements/s.
+ */
+template<typename QueueType>
+static void crossCore(QueueType* queue, double* rate)
+{
+	CHECK(queue->isEmpty());
+
+	const unsigned long long numberOfItems = 1000000;
+	bool success = true;
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producerThread(producer<QueueType>, queue, numberOfItems);
+	std::thread consumerThread(consumer<QueueType>, queue, numberOfItems,
+			&success);
+
+	pin(producerThread, 0);
+	pin(consumerThread, 1);
+
+	producerThread.join();
+	consumerThread.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	CHECK(success);
+
+	CHECK(queue->isEmpty());
+
+	*rate = numberOfItems / elapsed.count() / 1e6;
+}
+
+/**
+ * \brief The baseline for the throughput of Queue: a ring with the layout before
+ * the counters were aligned to cache lines, both counters next to each other
+ * and to the data pointer, and no cached counter of the other side.
+ */
+class PackedQueue
+{
+public:
+	explicit PackedQueue(uint32_t size) :
+			_data(new Data[size]),
+			_size(size),
+			_enqueued(0),
+			_dequeued(0)
+	{
+	}
+
+	~PackedQueue()
+	{
+		delete[] _data;
+	}
+
+	bool isEmpty() const
+	{
+		return _enqueued.load(std::memory_order_acquire) == _dequeued.load(std::memory_order_acquire);
+	}
+
+	bool enqueue(const Data& element)
+	{
+		bool success = false;
+		const uint32_t enqueued = _enqueued.load(std::memory_order_relaxed);
+
+		if (enqueued - _dequeued.load(std::memory_order_acquire) < _size)
+		{
+			_data[enqueued % _size] = element;
+			_enqueued.store(enqueued + 1, std::memory_order_release);
+			success = true;
+		}
+
+		return success;
+	}
+
+	bool dequeue(Data& element)
+	{
+		bool success = false;
+		const uint32_t dequeued = _dequeued.load(std::memory_order_relaxed);
+
+		if (_enqueued.load(std::memory_order_acquire) != dequeued)
+		{
+			element = _data[dequeued % _size];
+			_dequeued.store(dequeued + 1, std::memory_order_release);
+			success = true;
+		}
+
+		return success;
+	}
+
+private:
+	Data* const _data;
+	const uint32_t _size;
+	std::atomic<uint32_t> _enqueued;
+	std::atomic<uint32_t> _dequeued;
+};
+
 TEST(Queue_TestBench, Threadsafe)
 {
 	for (unsigned int i = 0; i < UNITS; i++)
 	{
-		CHECK(unitUnderTest[i]->isEmpty());
+		PackedQueue packed(QUEUE_SIZE[i]);
+		double baseline = 0;
+		double aligned = 0;
 
-		const unsigned long long numberOfItems = 1000000;
-		bool success = true;
+		crossCore(&packed, &baseline);
+		crossCore(unitUnderTest[i], &aligned);
 
-		std::thread producerThread(producer, unitUnderTest[i], numberOfItems);
-		std::thread consumerThread(consumer, unitUnderTest[i], numberOfItems,
-				&success);
+		UT_PRINT(StringFromFormat("Queue(%u) cross-core: packed %.1f, aligned %.1f M elements/s",
+				QUEUE_SIZE[i], baseline, aligned).asCharString());
+	}
+}
 
-		producerThread.join();
-		consumerThread.join();
+TEST(Queue_TestBench, BulkEnqueueDequeue)
+{
+	const unsigned int BLOCK = 1003;
+	Data stimulus[BLOCK];
+	Data response[BLOCK];
 
-		CHECK(success);
+	for (unsigned int c = 0; c < BLOCK; c++)
+	{
+		stimulus[c] = Data(c, ((c % 2) == 0));
+	}
+
+	for (unsigned int i = 0; i < UNITS; i++)
+	{
+		// Move the indices so the block wraps around the end of the queue.
+		for (unsigned int c = 0; c < QUEUE_SIZE[i] / 2; c++)
+		{
+			CHECK(unitUnderTest[i]->enqueue(Data()));
+			CHECK(unitUnderTest[i]->dequeue(response[0]));
+		}
 
+		// Only as many elements as there is room for are enqueued.
+		CHECK(unitUnderTest[i]->enqueue(stimulus, BLOCK) == QUEUE_SIZE[i]);
+		CHECK(unitUnderTest[i]->isFull());
+		CHECK(unitUnderTest[i]->enqueue(stimulus, BLOCK) == 0);
+
+		const uint16_t part = QUEUE_SIZE[i] / 3;
+		CHECK(unitUnderTest[i]->dequeue(response, part) == part);
+		CHECK(unitUnderTest[i]->dequeue(&response[part], BLOCK) == QUEUE_SIZE[i] - part);
 		CHECK(unitUnderTest[i]->isEmpty());
+		CHECK(unitUnderTest[i]->dequeue(response, BLOCK) == 0);
+
+		for (unsigned int c = 0; c < QUEUE_SIZE[i]; c++)
+		{
+			CHECK(response[c] == stimulus[c]);
+		}
 	}
 }
 
+/**
+ * \brief Keeps track of the number of live instances, has no default constructor.
+ */
+class Instance
+{
+public:
+	static int alive;
+
+	explicit Instance(int value) :
+			value(value)
+	{
+		alive++;
+	}
+
+	Instance(const Instance& other) :
+			value(other.value)
+	{
+		alive++;
+	}
+
+	Instance& operator=(const Instance& other) = default;
+
+	~Instance()
+	{
+		alive--;
+	}
+
+	int value;
+};
+
+int Instance::alive = 0;
+
+TEST(Queue_TestBench, ConstructOnEnqueueDestroyOnDequeue)
+{
+	{
+		Queue<Instance> queue(1000);
+		Flow::StaticQueue<Instance, 1000> staticQueue;
+
+		// Creating a queue does not construct any element.
+		CHECK(Instance::alive == 0);
+
+		CHECK(queue.emplace(1));
+		CHECK(queue.enqueue(Instance(2)));
+		CHECK(staticQueue.emplace(3));
+		CHECK(Instance::alive == 3);
+
+		Instance response(0);
+		CHECK(queue.dequeue(response));
+		CHECK(response.value == 1);
+		CHECK(staticQueue.dequeue(response));
+		CHECK(response.value == 3);
+		CHECK(Instance::alive == 2);
+
+		// Only the elements in the queue are copied.
+		Queue<Instance> copied(queue);
+		CHECK(Instance::alive == 3);
+
+		CHECK(copied.front()->value == 2);
+		copied.pop();
+		CHECK(Instance::alive == 2);
+	}
+
+	// Destroying a queue destroys the remaining elements.
+	CHECK(Instance::alive == 0);
+}
+
 TEST(Queue_TestBench, ElementsOverflow)
 {
 	for(int32_t i = 0; i <= UINT16_MAX; i++)
@@ -256,3 +484,236 @@ TEST(Queue_TestBench, ElementsOverflow)
 		CHECK(unitUnderTest[u]->isFull());
 	}
 }
+
+TEST(Queue_TestBench, WideIndex)
+{
+	const uint32_t size = 100000;
+	Queue<uint32_t, uint32_t> queue(size);
+
+	for(uint32_t c = 0; c < size; c++)
+	{
+		CHECK(queue.enqueue(c));
+	}
+
+	CHECK(queue.isFull());
+	CHECK(queue.elements() == size);
+
+	// Wrap around beyond the range of a 16 bit index.
+	uint32_t response;
+	for(uint32_t c = 0; c < size / 2; c++)
+	{
+		CHECK(queue.dequeue(response));
+		CHECK(response == c);
+		CHECK(queue.enqueue(size + c));
+	}
+
+	CHECK(queue.elements() == size);
+
+	for(uint32_t c = size / 2; c < size + size / 2; c++)
+	{
+		CHECK(queue.dequeue(response));
+		CHECK(response == c);
+	}
+
+	CHECK(queue.isEmpty());
+}
+
+/**
+ * \brief A clock that only advances when told to.
+ */
+struct TestClock
+{
+	typedef std::chrono::milliseconds duration;
+	typedef duration::rep rep;
+	typedef duration::period period;
+	typedef std::chrono::time_point<TestClock> time_point;
+	static const bool is_steady = true;
+
+	static rep ticks;
+
+	static time_point now()
+	{
+		return time_point(duration(ticks));
+	}
+};
+
+TestClock::rep TestClock::ticks = 0;
+
+TEST(Queue_TestBench, OccupancyStatistics)
+{
+	Queue<int, uint16_t, Flow::OccupancyStatistics<uint16_t, TestClock>> queue(8);
+
+	CHECK(queue.highWatermark() == 0);
+	CHECK(queue.rejectedFull() == 0);
+
+	// Occupancies 1 to 8: one in bucket 0, two in bucket 1, four in bucket 2 and one in bucket 3.
+	for (int c = 0; c < 8; c++)
+	{
+		CHECK(queue.enqueue(c));
+	}
+
+	CHECK(queue.highWatermark() == 8);
+	CHECK(queue.histogram(0) == 1);
+	CHECK(queue.histogram(1) == 2);
+	CHECK(queue.histogram(2) == 4);
+	CHECK(queue.histogram(3) == 1);
+	CHECK(queue.histogram(4) == 0);
+
+	TestClock::ticks = 100;
+	CHECK(!queue.enqueue(8));
+	TestClock::ticks = 130;
+	CHECK(queue.reserve() == nullptr);
+	const int elements[] = { 8, 9 };
+	CHECK(queue.enqueue(elements, 2) == 0);
+	CHECK(queue.rejectedFull() == 3);
+
+	// Still full, that period is not accounted for yet.
+	CHECK(queue.timeFull() == std::chrono::milliseconds(0));
+
+	int response;
+	CHECK(queue.dequeue(response));
+	CHECK(queue.dequeue(response));
+	TestClock::ticks = 150;
+	CHECK(queue.enqueue(elements, 2) == 2);
+
+	CHECK(queue.timeFull() == std::chrono::milliseconds(50));
+	CHECK(queue.highWatermark() == 8);
+	CHECK(queue.histogram(3) == 2);
+}
+
+TEST_GROUP(StaticQueue_TestBench)
+{
+	Flow::StaticQueue<Data, 1> one;
+	Flow::StaticQueue<Data, 10> ten;
+	Flow::StaticQueue<Data, 16> sixteen;
+	Flow::StaticQueue<Data, 1024> large;
+};
+
+template<typename QueueType>
+static void fillAndDrain(QueueType& queue, unsigned int size, unsigned int round)
+{
+	CHECK(queue.isEmpty());
+
+	for(unsigned int c = 0; c < size; c++)
+	{
+		CHECK(!queue.isFull());
+		CHECK(queue.enqueue(Data(round + c, true)));
+	}
+
+	CHECK(queue.isFull());
+	CHECK(!queue.enqueue(Data()));
+	CHECK(queue.elements() == size);
+
+	Data response;
+	for(unsigned int c = 0; c < size; c++)
+	{
+		CHECK(queue.peek(response));
+		CHECK(response == Data(round + c, true));
+		CHECK(queue.dequeue(response));
+		CHECK(response == Data(round + c, true));
+	}
+
+	CHECK(queue.isEmpty());
+	CHECK(!queue.dequeue(response));
+}
+
+TEST(StaticQueue_TestBench, SmallestIndex)
+{
+	CHECK((std::is_same<Flow::StaticQueue<Data, 10>::Index, uint8_t>::value));
+	CHECK((std::is_same<Flow::StaticQueue<Data, 1024>::Index, uint16_t>::value));
+	CHECK((std::is_same<Flow::StaticQueue<char, 70000>::Index, uint32_t>::value));
+	CHECK((std::is_same<Flow::StaticQueue<Data, 10, uint32_t>::Index, uint32_t>::value));
+}
+
+TEST(StaticQueue_TestBench, IsEmptyAfterCreation)
+{
+	Data response;
+	CHECK(one.isEmpty());
+	CHECK(!one.peek(response));
+	CHECK(ten.isEmpty());
+	CHECK(!ten.peek(response));
+	CHECK(sixteen.isEmpty());
+	CHECK(!sixteen.peek(response));
+}
+
+TEST(StaticQueue_TestBench, FullQueueWrapAround)
+{
+	for(unsigned int round = 0; round < 100; round++)
+	{
+		fillAndDrain(one, 1, round);
+		fillAndDrain(ten, 10, round);
+		fillAndDrain(sixteen, 16, round);
+
+		// Shift the indices so the next round wraps around somewhere else.
+		Data response;
+		CHECK(ten.enqueue(Data()));
+		CHECK(ten.dequeue(response));
+		CHECK(sixteen.enqueue(Data()));
+		CHECK(sixteen.dequeue(response));
+	}
+}
+
+TEST(StaticQueue_TestBench, CopyConstructor)
+{
+	Flow::StaticQueue<char, 2> other;
+	other.enqueue('0');
+	other.enqueue('1');
+	Flow::StaticQueue<char, 2> copied(other);
+	CHECK(copied.isFull());
+	char response;
+	CHECK(copied.dequeue(response));
+	CHECK(response == '0');
+	CHECK(other.isFull());
+}
+
+TEST(StaticQueue_TestBench, BulkNotTriviallyCopyable)
+{
+	Flow::StaticQueue<std::string, 4> queue;
+	const std::string stimulus[] = { "zero", "one", "two", "three", "four" };
+	std::string response[5];
+
+	CHECK(queue.enqueue(stimulus, 3) == 3);
+	CHECK(queue.dequeue(response, 2) == 2);
+	CHECK(queue.enqueue(&stimulus[3], 2) == 2);
+	CHECK(queue.dequeue(&response[2], 5) == 3);
+
+	for (unsigned int c = 0; c < 5; c++)
+	{
+		CHECK(response[c] == stimulus[c]);
+	}
+}
+
+TEST(StaticQueue_TestBench, MoveOnly)
+{
+	Flow::StaticQueue<std::unique_ptr<Data>, 2> queue;
+
+	std::unique_ptr<Data> stimulus(new Data(1, true));
+	CHECK(queue.enqueue(std::move(stimulus)));
+	CHECK(stimulus == nullptr);
+	CHECK(queue.emplace(new Data(2, false)));
+
+	// A full queue does not take the element.
+	std::unique_ptr<Data> rejected(new Data(3, true));
+	CHECK(!queue.enqueue(std::move(rejected)));
+	CHECK(rejected != nullptr);
+
+	std::unique_ptr<Data> response;
+	CHECK(queue.dequeue(response));
+	CHECK(*response == Data(1, true));
+	CHECK(queue.dequeue(response));
+	CHECK(*response == Data(2, false));
+	CHECK(!queue.dequeue(response));
+}
+
+TEST(StaticQueue_TestBench, Threadsafe)
+{
+	PackedQueue packed(1024);
+	double baseline = 0;
+	double aligned = 0;
+
+	crossCore(&packed, &baseline);
+	crossCore(&large, &aligned);
+
+	UT_PRINT(StringFromFormat("StaticQueue(1024) cross-core: packed %.1f, aligned %.1f M elements/s",
+			baseline, aligned).asCharString());
+}
@@ -0,0 +1,212 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/record.h"
+
+using Flow::Connection;
+using Flow::InRecord;
+using Flow::OutRecord;
+using Flow::Span;
+
+TEST_GROUP(Record_TestBench)
+{
+	OutRecord sender;
+	InRecord receiver{ nullptr };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connect(sender, receiver, 64);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+
+	void sendRecord(uint8_t value, size_t size)
+	{
+		uint8_t* region = sender.reserve(size);
+		CHECK(region != nullptr);
+		memset(region, value, size);
+		sender.commit(size);
+	}
+
+	void receiveRecord(uint8_t value, size_t size)
+	{
+		Span<const uint8_t> record = receiver.front();
+		CHECK(record.size == size);
+
+		for (size_t i = 0; i < record.size; i++)
+		{
+			CHECK(record.data[i] == value);
+		}
+
+		receiver.pop();
+	}
+};
+
+TEST(Record_TestBench, IsEmptyAfterCreation)
+{
+	CHECK(!receiver.peek());
+	CHECK(receiver.front().data == nullptr);
+	CHECK(receiver.front().size == 0);
+}
+
+TEST(Record_TestBench, SendReceive)
+{
+	const uint8_t hello[] = { 'h', 'e', 'l', 'l', 'o' };
+	const uint8_t world[] = { 'w', 'o', 'r', 'l', 'd', '!' };
+
+	CHECK(sender.send(hello, sizeof(hello)));
+	CHECK(sender.send(world, sizeof(world)));
+	CHECK(receiver.peek());
+
+	Span<const uint8_t> record = receiver.front();
+	CHECK(record.size == sizeof(hello));
+	CHECK(memcmp(record.data, hello, sizeof(hello)) == 0);
+	receiver.pop();
+
+	record = receiver.front();
+	CHECK(record.size == sizeof(world));
+	CHECK(memcmp(record.data, world, sizeof(world)) == 0);
+	receiver.pop();
+
+	CHECK(!receiver.peek());
+}
+
+TEST(Record_TestBench, ReserveCommit)
+{
+	// A reservation can be committed shorter, or discarded.
+	uint8_t* region = sender.reserve(40);
+	CHECK(region != nullptr);
+	CHECK(reinterpret_cast<uintptr_t>(region) % 4 == 0);
+	memset(region, 7, 3);
+	sender.commit(3);
+
+	CHECK(sender.reserve(56) == nullptr);
+	CHECK(sender.reserve(20) != nullptr);
+	sender.commit(0);
+
+	receiveRecord(7, 3);
+	CHECK(!receiver.peek());
+}
+
+TEST(Record_TestBench, WrapsWithoutSplitting)
+{
+	// Each record takes 16 bytes including its length.
+	for (uint8_t c = 0; c < 4; c++)
+	{
+		sendRecord(c, 12);
+	}
+
+	CHECK(sender.reserve(12) == nullptr);
+
+	// The receiver has to be beyond the record, else wrapping would make the buffer look empty.
+	receiveRecord(0, 12);
+	CHECK(sender.reserve(12) == nullptr);
+	receiveRecord(1, 12);
+
+	sendRecord(4, 12);
+	CHECK(sender.reserve(12) == nullptr);
+	CHECK(sender.reserve(8) != nullptr);
+	sender.commit(0);
+
+	receiveRecord(2, 12);
+	receiveRecord(3, 12);
+	receiveRecord(4, 12);
+	CHECK(!receiver.peek());
+
+	sendRecord(5, 40);
+	receiveRecord(5, 40);
+	CHECK(!receiver.peek());
+}
+
+TEST(Record_TestBench, Unconnected)
+{
+	OutRecord unconnectedSender;
+	InRecord unconnectedReceiver{ nullptr };
+	const uint8_t data[] = { 1 };
+
+	CHECK(unconnectedSender.reserve(1) == nullptr);
+	CHECK(!unconnectedSender.send(data, sizeof(data)));
+	CHECK(!unconnectedReceiver.peek());
+	CHECK(unconnectedReceiver.front().size == 0);
+}
+
+static void producer(OutRecord* sender, const uint32_t count)
+{
+	for (uint32_t c = 0; c < count; c++)
+	{
+		const size_t size = c % 50 + 1;
+		uint8_t* region;
+
+		while ((region = sender->reserve(size)) == nullptr)
+			;
+
+		memset(region, static_cast<uint8_t>(c), size);
+		sender->commit(size);
+	}
+}
+
+TEST(Record_TestBench, Threadsafe)
+{
+	OutRecord threadSender;
+	InRecord threadReceiver{ nullptr };
+	Connection* threaded = Flow::connect(threadSender, threadReceiver, 4096);
+
+	const uint32_t count = 100000;
+	std::thread producerThread(producer, &threadSender, count);
+
+	bool success = true;
+
+	for (uint32_t c = 0; c < count; c++)
+	{
+		Span<const uint8_t> record;
+
+		while ((record = threadReceiver.front()).size == 0)
+			;
+
+		success = success && (record.size == c % 50 + 1);
+
+		for (size_t i = 0; i < record.size; i++)
+		{
+			success = success && (record.data[i] == static_cast<uint8_t>(c));
+		}
+
+		threadReceiver.pop();
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+	CHECK(!threadReceiver.peek());
+
+	Flow::disconnect(threaded);
+}
@@ -0,0 +1,287 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#include <memory>
+#include <stdint.h>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/segmented.h"
+
+#include "data.h"
+
+using Flow::Connection;
+using Flow::ConnectionSegmented;
+using Flow::OutPort;
+using Flow::InPort;
+
+TEST_GROUP(Segmented_TestBench)
+{
+	OutPort<uint32_t> sender;
+	InPort<uint32_t> receiver{ nullptr };
+	ConnectionSegmented<uint32_t, 4>* connection;
+
+	void setup()
+	{
+		connection = new ConnectionSegmented<uint32_t, 4>(sender, receiver, 3);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(Segmented_TestBench, IsEmptyAfterCreation)
+{
+	uint32_t response;
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+	CHECK(receiver.front() == nullptr);
+	CHECK(!sender.full());
+	CHECK(connection->chunks() == 1);
+}
+
+TEST(Segmented_TestBench, GrowsInChunks)
+{
+	uint32_t response;
+
+	for (uint32_t c = 0; c < 10; c++)
+	{
+		CHECK(sender.send(c));
+	}
+
+	CHECK(connection->chunks() == 3);
+
+	for (uint32_t c = 0; c < 10; c++)
+	{
+		CHECK(receiver.peek());
+		CHECK(*receiver.front() == c);
+		CHECK(receiver.receive(response));
+		CHECK(response == c);
+	}
+
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+}
+
+TEST(Segmented_TestBench, Ceiling)
+{
+	uint32_t response;
+
+	for (uint32_t c = 0; c < 12; c++)
+	{
+		CHECK(sender.send(c));
+	}
+
+	CHECK(sender.full());
+	CHECK(!sender.send(12));
+
+	// The first chunk is only recycled once the receiver moves on to the next one.
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(receiver.receive(response));
+	}
+
+	CHECK(!sender.send(12));
+	CHECK(receiver.receive(response));
+	CHECK(response == 4);
+	CHECK(!sender.full());
+
+	for (uint32_t c = 12; c < 16; c++)
+	{
+		CHECK(sender.send(c));
+	}
+
+	CHECK(!sender.send(16));
+	CHECK(connection->chunks() == 3);
+
+	for (uint32_t c = 5; c < 16; c++)
+	{
+		CHECK(receiver.receive(response));
+		CHECK(response == c);
+	}
+}
+
+TEST(Segmented_TestBench, ReusesChunks)
+{
+	uint32_t response;
+
+	for (uint32_t c = 0; c < 1000; c++)
+	{
+		CHECK(sender.send(c));
+		CHECK(receiver.receive(response));
+		CHECK(response == c);
+	}
+
+	CHECK(connection->chunks() == 2);
+}
+
+TEST(Segmented_TestBench, ReleasesBurst)
+{
+	OutPort<uint32_t> burstSender;
+	InPort<uint32_t> burstReceiver{ nullptr };
+	ConnectionSegmented<uint32_t, 4> burst(burstSender, burstReceiver);
+	uint32_t response;
+
+	for (uint32_t c = 0; c < 40; c++)
+	{
+		CHECK(burstSender.send(c));
+	}
+
+	CHECK(burst.chunks() == 10);
+
+	for (uint32_t c = 0; c < 40; c++)
+	{
+		CHECK(burstReceiver.receive(response));
+		CHECK(response == c);
+	}
+
+	// Only the last chunk and one spare remain.
+	CHECK(!burstReceiver.receive(response));
+	CHECK(burst.chunks() == 2);
+}
+
+TEST(Segmented_TestBench, MoveOnly)
+{
+	OutPort<std::unique_ptr<Data>> moveOnlySender;
+	InPort<std::unique_ptr<Data>> moveOnlyReceiver{ nullptr };
+	Connection* moveOnly = Flow::connectSegmented<2>(moveOnlySender, moveOnlyReceiver, 2);
+
+	std::unique_ptr<Data> stimulus(new Data(1, true));
+	CHECK(moveOnlySender.send(std::move(stimulus)));
+	CHECK(moveOnlySender.emplace(new Data(2, false)));
+	CHECK(moveOnlySender.emplace(new Data(3, true)));
+	CHECK(moveOnlySender.emplace(new Data(4, false)));
+
+	std::unique_ptr<Data> rejected(new Data(5, true));
+	CHECK(!moveOnlySender.send(std::move(rejected)));
+	CHECK(rejected != nullptr);
+
+	std::unique_ptr<Data> response;
+	CHECK(moveOnlyReceiver.receive(response));
+	CHECK(*response == Data(1, true));
+	CHECK(moveOnlyReceiver.receive(response));
+	CHECK(*response == Data(2, false));
+	CHECK(moveOnlyReceiver.receive(response));
+	CHECK(*response == Data(3, true));
+
+	// Remaining elements are destroyed with the connection.
+	CHECK(moveOnlySender.send(std::move(rejected)));
+	Flow::disconnect(moveOnly);
+}
+
+static void producer(OutPort<uint64_t>* sender, const uint64_t count)
+{
+	for (uint64_t c = 0; c < count; c++)
+	{
+		while (!sender->send(c))
+			;
+	}
+}
+
+TEST(Segmented_TestBench, Threadsafe)
+{
+	OutPort<uint64_t> threadSender;
+	InPort<uint64_t> threadReceiver{ nullptr };
+	Connection* threaded = Flow::connectSegmented<16>(threadSender, threadReceiver, 8, 2);
+
+	const uint64_t count = 1000000;
+	std::thread producerThread(producer, &threadSender, count);
+
+	bool success = true;
+
+	for (uint64_t c = 0; c < count; c++)
+	{
+		uint64_t response = 0;
+
+		while (!threadReceiver.receive(response))
+			;
+
+		success = success && (response == c);
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+	CHECK(!threadReceiver.peek());
+
+	Flow::disconnect(threaded);
+}
+
+static void politeProducer(OutPort<uint64_t>* sender, const uint64_t count)
+{
+	for (uint64_t c = 0; c < count; c++)
+	{
+		while (!sender->send(c))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+TEST(Segmented_TestBench, FullWhileSending)
+{
+	OutPort<uint64_t> threadSender;
+	InPort<uint64_t> threadReceiver{ nullptr };
+	Connection* threaded = Flow::connectSegmented<4>(threadSender, threadReceiver, 2, 0);
+
+	const uint64_t count = 20000;
+	std::thread producerThread(politeProducer, &threadSender, count);
+
+	bool success = true;
+
+	for (uint64_t c = 0; c < count; c++)
+	{
+		uint64_t response = 0;
+
+		// The receiver asks while the sender is sending.
+		threadReceiver.full();
+
+		while (!threadReceiver.receive(response))
+		{
+			threadReceiver.full();
+			std::this_thread::yield();
+		}
+
+		success = success && (response == c);
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+	CHECK(!threadReceiver.full());
+
+	uint64_t sent = 0;
+
+	while (threadSender.send(sent))
+	{
+		sent++;
+	}
+
+	CHECK(sent >= 4);
+	CHECK(threadReceiver.full());
+
+	Flow::disconnect(threaded);
+}
@@ -0,0 +1,220 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#if defined(__unix__)
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/shared.h"
+
+using Flow::Connection;
+using Flow::ConnectionShared;
+using Flow::OutPort;
+using Flow::InPort;
+
+TEST_GROUP(Shared_TestBench)
+{
+	char name[32];
+	OutPort<uint32_t> sender;
+	InPort<uint32_t> receiver{ nullptr };
+
+	void setup()
+	{
+		snprintf(name, sizeof(name), "/flow_shared_%d", static_cast<int>(getpid()));
+	}
+
+	bool exists()
+	{
+		const int descriptor = shm_open(name, O_RDWR, 0);
+
+		if (descriptor >= 0)
+		{
+			close(descriptor);
+		}
+
+		return descriptor >= 0;
+	}
+};
+
+TEST(Shared_TestBench, SendReceive)
+{
+	Connection* sending = Flow::connectShared(sender, name, 4);
+	Connection* receiving = Flow::connectShared(receiver, name, 4);
+	CHECK(sending != nullptr);
+	CHECK(receiving != nullptr);
+
+	uint32_t response;
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(sender.send(c));
+	}
+
+	CHECK(sender.full());
+	CHECK(!sender.send(4));
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(receiver.receive(response));
+		CHECK(response == c);
+	}
+
+	CHECK(!receiver.peek());
+
+	// The last side to detach removes the segment.
+	Flow::disconnect(sending);
+	CHECK(exists());
+	Flow::disconnect(receiving);
+	CHECK(!exists());
+}
+
+TEST(Shared_TestBench, OneProcessPerSide)
+{
+	OutPort<uint32_t> otherSender;
+	InPort<uint32_t> otherReceiver{ nullptr };
+
+	Connection* sending = Flow::connectShared(sender, name, 4);
+	CHECK(sending != nullptr);
+	CHECK(Flow::connectShared(otherSender, name, 4) == nullptr);
+
+	// The size has to match.
+	CHECK(Flow::connectShared(otherReceiver, name, 8) == nullptr);
+
+	Flow::disconnect(sending);
+	CHECK(!exists());
+}
+
+TEST(Shared_TestBench, PeerAttached)
+{
+	ConnectionShared<uint32_t>* sending = new ConnectionShared<uint32_t>(sender, name, 4);
+	CHECK(sending->attached());
+	CHECK(!sending->peerAttached());
+
+	ConnectionShared<uint32_t>* receiving = new ConnectionShared<uint32_t>(receiver, name, 4);
+	CHECK(receiving->attached());
+	CHECK(receiving->peerAttached());
+	CHECK(sending->peerAttached());
+
+	Flow::disconnect(receiving);
+	CHECK(!sending->peerAttached());
+
+	Flow::disconnect(sending);
+}
+
+TEST(Shared_TestBench, CrashedPeer)
+{
+	const pid_t child = fork();
+
+	if (child == 0)
+	{
+		// Send two elements and crash, without detaching.
+		OutPort<uint32_t> crashing;
+		Flow::connectShared(crashing, name, 4);
+		crashing.send(1);
+		crashing.send(2);
+		_exit(0);
+	}
+
+	int status;
+	CHECK(waitpid(child, &status, 0) == child);
+
+	ConnectionShared<uint32_t>* receiving = new ConnectionShared<uint32_t>(receiver, name, 4);
+	CHECK(receiving->attached());
+	CHECK(!receiving->peerAttached());
+
+	uint32_t response;
+	CHECK(receiver.receive(response));
+	CHECK(response == 1);
+
+	// A new sender takes over from the crashed one.
+	Connection* sending = Flow::connectShared(sender, name, 4);
+	CHECK(sending != nullptr);
+	CHECK(receiving->peerAttached());
+	CHECK(sender.send(3));
+
+	CHECK(receiver.receive(response));
+	CHECK(response == 2);
+	CHECK(receiver.receive(response));
+	CHECK(response == 3);
+
+	Flow::disconnect(sending);
+	Flow::disconnect(receiving);
+	CHECK(!exists());
+}
+
+TEST(Shared_TestBench, Threadsafe)
+{
+	const uint64_t count = 1000000;
+	InPort<uint64_t> processReceiver{ nullptr };
+	Connection* receiving = Flow::connectShared(processReceiver, name, 1024);
+	CHECK(receiving != nullptr);
+
+	const pid_t child = fork();
+
+	if (child == 0)
+	{
+		OutPort<uint64_t> processSender;
+		Connection* sending = Flow::connectShared(processSender, name, 1024);
+
+		for (uint64_t c = 0; c < count; c++)
+		{
+			while (!processSender.send(c))
+				;
+		}
+
+		Flow::disconnect(sending);
+		_exit(0);
+	}
+
+	bool success = true;
+
+	for (uint64_t c = 0; c < count; c++)
+	{
+		uint64_t response = 0;
+
+		while (!processReceiver.receive(response))
+			;
+
+		success = success && (response == c);
+	}
+
+	int status;
+	CHECK(waitpid(child, &status, 0) == child);
+
+	CHECK(success);
+	CHECK(!processReceiver.peek());
+
+	Flow::disconnect(receiving);
+	CHECK(!exists());
+}
+
+#endif // __unix__
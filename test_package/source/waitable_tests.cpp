@@ -0,0 +1,164 @@
+/* The MIT License (MIT)
+ *
+ * Copyright (c) 2020 Cynara Krewe
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software, hardware and associated documentation files (the "Solution"), to deal
+ * in the Solution without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Solution, and to permit persons to whom the Solution is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Solution.
+ *
+ * THE SOLUTION IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOLUTION OR THE USE OR OTHER DEALINGS IN THE
+ * SOLUTION.
+ */
+
+#if defined(__linux__)
+
+#include <stdint.h>
+#include <chrono>
+#include <thread>
+
+#include "CppUTest/TestHarness.h"
+
+#include "flow/waitable.h"
+
+using Flow::Connection;
+using Flow::OutPort;
+using Flow::InPort;
+
+TEST_GROUP(Waitable_TestBench)
+{
+	OutPort<uint32_t> sender;
+	InPort<uint32_t> receiver{ nullptr };
+	Connection* connection;
+
+	void setup()
+	{
+		connection = Flow::connectWaitable(sender, receiver, 4);
+	}
+
+	void teardown()
+	{
+		Flow::disconnect(connection);
+	}
+};
+
+TEST(Waitable_TestBench, SendReceive)
+{
+	uint32_t response;
+	CHECK(!receiver.peek());
+	CHECK(!receiver.receive(response));
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(sender.send(c));
+	}
+
+	CHECK(sender.full());
+	CHECK(!sender.send(4));
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(receiver.receiveWait(response));
+		CHECK(response == c);
+	}
+
+	CHECK(!receiver.peek());
+}
+
+TEST(Waitable_TestBench, TimesOut)
+{
+	const std::chrono::milliseconds timeout(20);
+	uint32_t response;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CHECK(!receiver.receiveWait(response, timeout));
+	CHECK(std::chrono::steady_clock::now() - start >= timeout);
+
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		CHECK(sender.sendWait(c, timeout));
+	}
+
+	start = std::chrono::steady_clock::now();
+	CHECK(!sender.sendWait(4, timeout));
+	CHECK(std::chrono::steady_clock::now() - start >= timeout);
+}
+
+TEST(Waitable_TestBench, OtherConnectionsDoNotWait)
+{
+	OutPort<uint32_t> fifoSender;
+	InPort<uint32_t> fifoReceiver{ nullptr };
+	Connection* fifo = Flow::connect(fifoSender, fifoReceiver, 1);
+	uint32_t response;
+
+	CHECK(!fifoReceiver.receiveWait(response));
+	CHECK(fifoSender.sendWait(1));
+	CHECK(!fifoSender.sendWait(2));
+	CHECK(fifoReceiver.receiveWait(response));
+	CHECK(response == 1);
+
+	Flow::disconnect(fifo);
+
+	CHECK(!fifoSender.sendWait(3));
+	CHECK(!fifoReceiver.receiveWait(response));
+}
+
+TEST(Waitable_TestBench, WakesTheReceiver)
+{
+	std::thread producerThread([this]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		sender.send(123);
+	});
+
+	uint32_t response = 0;
+	CHECK(receiver.receiveWait(response));
+	CHECK(response == 123);
+
+	producerThread.join();
+}
+
+static void producer(OutPort<uint64_t>* sender, const uint64_t count)
+{
+	for (uint64_t c = 0; c < count; c++)
+	{
+		sender->sendWait(c);
+	}
+}
+
+TEST(Waitable_TestBench, Threadsafe)
+{
+	OutPort<uint64_t> threadSender;
+	InPort<uint64_t> threadReceiver{ nullptr };
+	Connection* threaded = Flow::connectWaitable(threadSender, threadReceiver, 16);
+
+	const uint64_t count = 1000000;
+	std::thread producerThread(producer, &threadSender, count);
+
+	bool success = true;
+
+	for (uint64_t c = 0; c < count; c++)
+	{
+		uint64_t response = 0;
+		success = success && threadReceiver.receiveWait(response) && (response == c);
+	}
+
+	producerThread.join();
+
+	CHECK(success);
+	CHECK(!threadReceiver.peek());
+
+	Flow::disconnect(threaded);
+}
+
+#endif // __linux__